@@ -0,0 +1,239 @@
+#include "header.h"
+
+// the seeds the candidate layouts and their hunts are drawn from. they are
+// fixed so a book only depends on the config it is built for
+const uint64_t LAYOUT_SEED = 0x6c61796f7574;
+const uint64_t HUNT_SEED = 0x68756e74;
+
+// the layout books built so far, one per config. a book is never changed
+// once it is built, so the games share it on every thread
+static mutex layoutBookLock;
+static vector<shared_ptr<const LayoutBook>> layoutBooks;
+
+// function returns what a layout book for 'config' depends on, written out
+// so books can be told apart by it
+string layoutBookKey(const GameConfig& config) {
+    const PlacementSettings& settings = config.placement;
+
+    string key = to_string(config.numRows) + "x" + to_string(config.numCols) + " ships";
+
+    for (const Ship& ship : config.fleetTemplate->ships) {
+        key += " " + to_string(ship.size);
+    }
+
+    key += " candidates " + to_string(settings.numCandidates) + " hunts " + to_string(settings.maxHunts) + " layouts " + to_string(settings.numLayouts);
+    key += " budget " + to_string(settings.timeBudgetMs) + " exact " + to_string(config.exactSolver.layoutThreshold) + " " + to_string(config.exactSolver.timeBudgetMs);
+
+    return key;
+}
+
+// function returns how 'ship' lies on the board
+Placement shipPlacement(const Ship& ship) {
+    const Point& start = ship.points.front();
+    const bool isVertical = ship.points.size() > 1 && ship.points[1].colIndex == start.colIndex;
+
+    return {ship.size, start.rowIndex, start.colIndex, isVertical ? 'V' : 'H'};
+}
+
+// function has the heuristic targeting engine hunt 'layout' until its whole
+// fleet has sunk, in the game 'context' was last reset to. returns how many
+// shots that took
+int huntLayout(GameContext& context, const Player& layout, GameRng& rng) {
+    Player& target = context.players[1];
+    ComputerState& hunter = context.computers[0];
+    int& numShips = context.numShips[1];
+
+    int numShots = 0;
+
+    target = layout;
+
+    while (numShips > 0) {
+        computerTurn(target, numShips, hunter, rng, false);
+        numShots++;
+    }
+
+    return numShots;
+}
+
+// function builds the layout book for 'config' into 'book'. candidates are
+// dropped by successive halving: every round hunts each layout left twice
+// as often as the round before, and keeps the better half by the mean of
+// its hunts, until 'numLayouts' are left and have been hunted 'maxHunts'
+// times each. every hunt draws from a generator of its own, so the book
+// does not depend on how many threads hunt
+void buildLayoutBook(LayoutBook& book, const GameConfig& config) {
+    const PlacementSettings& settings = config.placement;
+
+    auto start = chrono::steady_clock::now();
+
+    const bool hasDeadline = settings.timeBudgetMs > 0;
+    const auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(settings.timeBudgetMs));
+
+    // the hunts are games of their own: the heuristic engine fires at a
+    // fleet that is already placed, so nothing in them is adversarial
+    GameConfig huntConfig = config;
+
+    huntConfig.engines[0] = HEURISTIC_TARGETING;
+    huntConfig.placements[0] = RANDOM_PLACEMENT;
+    huntConfig.placements[1] = RANDOM_PLACEMENT;
+    huntConfig.layoutBook = nullptr;
+
+    const int numCandidates = max(1, settings.numCandidates);
+    const int numLayouts = max(1, min(settings.numLayouts, numCandidates));
+    const int maxHunts = max(1, settings.maxHunts);
+    const int numThreads = max(1, settings.numThreads);
+
+    vector<GameContext> contexts(numThreads);
+    vector<Player> candidates(numCandidates);
+
+    resetGameContext(contexts[0], huntConfig);
+
+    for (int candidate = 0; candidate < numCandidates; candidate++) {
+        GameRng rng = makeGameRng(LAYOUT_SEED, candidate);
+
+        candidates[candidate] = contexts[0].freshPlayer;
+        computerStartShipPlacement(contexts[0].players[0], candidates[candidate], rng);
+    }
+
+    vector<int> numHunts(numCandidates, 0);
+    vector<long long> totalShots(numCandidates, 0);
+    vector<int> survivors(numCandidates);
+    atomic<bool> isOutOfTime(false);
+
+    for (int candidate = 0; candidate < numCandidates; candidate++) {
+        survivors[candidate] = candidate;
+    }
+
+    auto meanShots = [&](int candidate) {
+        return (numHunts[candidate] > 0) ? (double)totalShots[candidate] / numHunts[candidate] : 0.0;
+    };
+
+    int roundHunts = min(2, maxHunts);
+    bool isFirstRound = true;
+
+    while (true) {
+        runParallel(survivors.size(), numThreads, [&](int task, int worker) {
+            const int candidate = survivors[task];
+            GameContext& context = contexts[worker];
+
+            while (numHunts[candidate] < roundHunts) {
+                if (hasDeadline && chrono::steady_clock::now() > deadline) {
+                    isOutOfTime = true;
+                    return;
+                }
+
+                GameRng rng = makeGameRng(HUNT_SEED + candidate, numHunts[candidate]);
+
+                resetGameContext(context, huntConfig);
+
+                totalShots[candidate] += huntLayout(context, candidates[candidate], rng);
+                numHunts[candidate]++;
+            }
+        });
+
+        // the first round is every candidate as it was placed at random
+        if (isFirstRound) {
+            long long shots = 0;
+            long long hunts = 0;
+
+            for (int candidate = 0; candidate < numCandidates; candidate++) {
+                shots += totalShots[candidate];
+                hunts += numHunts[candidate];
+            }
+
+            book.randomMeanShots = (hunts > 0) ? (double)shots / hunts : 0.0;
+            isFirstRound = false;
+        }
+
+        // the layouts that took the most shots to sink first, the earlier
+        // candidate first on a tie
+        stable_sort(survivors.begin(), survivors.end(), [&](int first, int second) {
+            return meanShots(first) > meanShots(second);
+        });
+
+        if (isOutOfTime || ((int)survivors.size() <= numLayouts && roundHunts == maxHunts)) {
+            break;
+        }
+
+        survivors.resize(max(numLayouts, (int)survivors.size() / 2));
+        roundHunts = min(maxHunts, roundHunts * 2);
+    }
+
+    survivors.resize(numLayouts);
+
+    for (int candidate : survivors) {
+        vector<Placement> layout;
+
+        for (const Ship& ship : candidates[candidate].fleet) {
+            layout.push_back(shipPlacement(ship));
+        }
+
+        book.layouts.push_back(layout);
+        book.meanShots.push_back(meanShots(candidate));
+    }
+
+    for (int hunts : numHunts) {
+        book.numHunts += hunts;
+    }
+
+    book.numCandidates = numCandidates;
+    book.buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// function returns the layout book for 'config', building it the first
+// time one is asked for. the fleet template of 'config' has to be loaded
+shared_ptr<const LayoutBook> findLayoutBook(const GameConfig& config) {
+    const string key = layoutBookKey(config);
+
+    lock_guard<mutex> guard(layoutBookLock);
+
+    for (const shared_ptr<const LayoutBook>& book : layoutBooks) {
+        if (book->key == key) {
+            return book;
+        }
+    }
+
+    auto book = make_shared<LayoutBook>();
+
+    book->key = key;
+    buildLayoutBook(*book, config);
+
+    layoutBooks.push_back(book);
+
+    return book;
+}
+
+// function places the fleet of 'computer' like one of the layouts in
+// 'book', picked at random and then mirrored at random. the heuristic
+// engine does not favour a side of the board, so a mirrored layout holds
+// out as long as the one in the book. a square board is turned on its
+// diagonal at random too
+void placeBookLayout(Player& computer, const LayoutBook& book, GameRng& rng) {
+    const int numRows = computer.board.numRows;
+    const int numCols = computer.board.numCols;
+
+    const vector<Placement>& layout = book.layouts[randomBelow(rng, book.layouts.size())];
+
+    const bool isTransposed = (numRows == numCols) && randomBelow(rng, 2) == 1;
+    const bool isRowFlipped = randomBelow(rng, 2) == 1;
+    const bool isColFlipped = randomBelow(rng, 2) == 1;
+
+    for (int shipIndex = 0; shipIndex < (int)layout.size(); shipIndex++) {
+        const Placement& placement = layout[shipIndex];
+        const bool isVertical = (placement.orientation == 'V') != isTransposed;
+
+        int rowIndex = isTransposed ? placement.colIndex : placement.rowIndex;
+        int colIndex = isTransposed ? placement.rowIndex : placement.colIndex;
+
+        // a flip moves the start of the ship to its other end
+        if (isRowFlipped) {
+            rowIndex = numRows - 1 - rowIndex - (isVertical ? placement.shipSize - 1 : 0);
+        }
+
+        if (isColFlipped) {
+            colIndex = numCols - 1 - colIndex - (isVertical ? 0 : placement.shipSize - 1);
+        }
+
+        placeShipAt(computer, shipIndex, rowIndex, colIndex, isVertical ? 'V' : 'H');
+    }
+}
@@ -0,0 +1,145 @@
+// counts the heap allocations made while the computers take their turns,
+// and over whole games played in a reused game context. once the computer
+// states and the context have warmed up neither should allocate at all,
+// and the program fails if one does. build from the repository root with
+//
+//   g++ -std=c++17 -O2 -I. bench/alloc_bench.cpp adversary.cpp bitboard.cpp functions.cpp input.cpp instrument.cpp matchmaking.cpp montecarlo.cpp placement.cpp record.cpp render.cpp replay.cpp server.cpp session.cpp simulation.cpp solver.cpp -o alloc_bench
+//
+// and run it from there so 'ships.txt' is found. '--rows', '--cols' and
+// '--ships' pick the board and fleet the same way they do for the game
+#include <new>
+
+#include "header.h"
+
+// every allocation made through 'operator new' is counted while
+// 'isCounting' is set
+static long long numAllocations = 0;
+static bool isCounting = false;
+
+void* operator new(size_t size) {
+    if (isCounting) {
+        numAllocations++;
+    }
+
+    void* memory = malloc(size == 0 ? 1 : size);
+
+    if (memory == nullptr) {
+        throw bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+int main(int argc, char* argv[]) {
+    const int numWarmUpGames = 200;
+    const int numGames = 2000;
+
+    GameConfig config;
+
+    for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2) {
+        string option = argv[argIndex];
+
+        if (option == "--rows") {
+            config.numRows = atoi(argv[argIndex + 1]);
+        } else if (option == "--cols") {
+            config.numCols = atoi(argv[argIndex + 1]);
+        } else if (option == "--ships") {
+            config.shipsFile = argv[argIndex + 1];
+        }
+    }
+
+    // the games copy their fleets from the template, like the simulation
+    auto fleetTemplate = make_shared<FleetTemplate>();
+    string fleetError;
+
+    if (!loadFleetTemplate(*fleetTemplate, config.shipsFile, fleetError)) {
+        cout << fleetError << "\n";
+        return 1;
+    }
+
+    config.fleetTemplate = fleetTemplate;
+
+    Player computer1, computer2;
+    ComputerState state1, state2;
+
+    long long numShots = 0;
+
+    for (int game = 0; game < numWarmUpGames + numGames; game++) {
+        GameRng rng = makeGameRng(2024, game);
+
+        // sets up the game the same way 'simulateGame()' does, only the
+        // turns are counted
+        resetComputerState(state1);
+        resetComputerState(state2);
+
+        initFleet(computer1, config);
+        initFleet(computer2, config);
+
+        computerStartShipPlacement(computer2, computer1, rng);
+        computerStartShipPlacement(computer1, computer2, rng);
+
+        int computer1NumShips = computer1.fleet.size();
+        int computer2NumShips = computer2.fleet.size();
+
+        // the first turn of a game sets up the placement index, which is
+        // not part of a shot
+        computerTurn(computer2, computer2NumShips, state1, rng, false);
+        computerTurn(computer1, computer1NumShips, state2, rng, false);
+
+        isCounting = (game >= numWarmUpGames);
+
+        while (computer1NumShips > 0 && computer2NumShips > 0) {
+            computerTurn(computer2, computer2NumShips, state1, rng, false);
+            numShots += isCounting;
+
+            if (computer2NumShips == 0) {
+                break;
+            }
+
+            computerTurn(computer1, computer1NumShips, state2, rng, false);
+            numShots += isCounting;
+        }
+
+        isCounting = false;
+    }
+
+    cout << "Games: " << numGames << " after " << numWarmUpGames << " warm-up games, shots counted: " << numShots << "\n";
+    cout << "Allocations during turns: " << numAllocations << " (" << double(numAllocations) / max(1LL, numShots) << " per shot)\n";
+
+    const long long numTurnAllocations = numAllocations;
+
+    // whole games the way the simulation plays them, setting up included
+    GameContext context;
+
+    numAllocations = 0;
+
+    for (int game = 0; game < numWarmUpGames + numGames; game++) {
+        GameRng rng = makeGameRng(2024, game);
+
+        isCounting = (game >= numWarmUpGames);
+        simulateGame(context, config, rng, nullptr);
+        isCounting = false;
+    }
+
+    cout << "Allocations during whole games: " << numAllocations << " (" << double(numAllocations) / numGames << " per game)\n";
+
+    if (numTurnAllocations != 0) {
+        cout << "A computer turn allocated memory.\n";
+        return 1;
+    }
+
+    if (numAllocations != 0) {
+        cout << "A game allocated memory.\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,352 @@
+// micro-benchmarks of the game primitives and the computer's targeting, and a
+// macro-benchmark of whole computer vs computer games, built on Google
+// Benchmark. every benchmark runs on the standard 6x6 board and the classic
+// 10x10 board, the board size is the benchmark's argument. build from the
+// repository root with
+//
+//   g++ -std=c++17 -O2 -I. bench/game_bench.cpp adversary.cpp bitboard.cpp functions.cpp input.cpp instrument.cpp matchmaking.cpp montecarlo.cpp placement.cpp record.cpp render.cpp replay.cpp server.cpp session.cpp simulation.cpp solver.cpp -lbenchmark -lpthread -o game_bench
+//
+// and run it from there so 'ships.txt' is found. to keep the results for
+// comparing against another commit, write them out as JSON with
+//
+//   ./game_bench --benchmark_out=game_bench.json --benchmark_out_format=json
+#include <benchmark/benchmark.h>
+
+#include "header.h"
+#include "hunt_density.h"
+
+// a game part way through, seen by the computer firing at 'player'
+struct GameSnapshot {
+    Player player;
+    int fleetSize;
+    ComputerState computer;
+};
+
+// function returns the config of a square board with 'boardSize' rows,
+// with the fleet template loaded like the game does
+GameConfig makeBenchConfig(int boardSize) {
+    GameConfig config;
+    auto fleetTemplate = make_shared<FleetTemplate>();
+    string fleetError;
+
+    config.numRows = boardSize;
+    config.numCols = boardSize;
+
+    if (loadFleetTemplate(*fleetTemplate, config.shipsFile, fleetError)) {
+        config.fleetTemplate = fleetTemplate;
+    }
+
+    return config;
+}
+
+// function places a fleet at random on a fresh board
+Player makePlacedPlayer(const GameConfig& config, GameRng& rng) {
+    Player player, other;
+
+    initFleet(player, config);
+    initFleet(other, config);
+    computerStartShipPlacement(other, player, rng);
+
+    return player;
+}
+
+// function plays computer turns against random fleets and keeps 'numSnapshots'
+// of the games as they are right after a turn that 'isWanted' accepts
+vector<GameSnapshot> makeSnapshots(const GameConfig& config, int numSnapshots, const function<bool(const GameSnapshot&)>& isWanted) {
+    GameRng rng(2024);
+    vector<GameSnapshot> snapshots;
+
+    while ((int)snapshots.size() < numSnapshots) {
+        GameSnapshot game;
+
+        game.player = makePlacedPlayer(config, rng);
+        game.fleetSize = game.player.fleet.size();
+        resetComputerState(game.computer);
+
+        // stops at a random point of the game so the snapshots are spread
+        // over it
+        int numTurns = 1 + randomBelow(rng, config.numRows * config.numCols / 2);
+
+        for (int turn = 0; turn < numTurns && game.fleetSize > 0; turn++) {
+            computerTurn(game.player, game.fleetSize, game.computer, rng, false);
+
+            if (game.fleetSize > 0 && isWanted(game)) {
+                snapshots.push_back(game);
+                break;
+            }
+        }
+    }
+
+    return snapshots;
+}
+
+// sets up an empty board and copies the fleet template into it
+void BM_InitFleet(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    Player player;
+
+    for (auto _ : state) {
+        initFleet(player, config);
+        benchmark::DoNotOptimize(player.fleet.data());
+    }
+}
+
+BENCHMARK(BM_InitFleet)->Arg(6)->Arg(10);
+
+// places a whole fleet at random. the empty board and fleet are copied in
+// before every placement, which is timed too
+void BM_ComputerStartShipPlacement(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    GameRng rng(2024);
+    Player empty, other, player;
+
+    initFleet(empty, config);
+    initFleet(other, config);
+
+    for (auto _ : state) {
+        player = empty;
+        computerStartShipPlacement(other, player, rng);
+        benchmark::DoNotOptimize(player.board.cells.data());
+    }
+}
+
+BENCHMARK(BM_ComputerStartShipPlacement)->Arg(6)->Arg(10);
+
+// places a whole fleet like a layout of the adversarial placement, mirrored
+// at random. the layouts are found before the timing starts
+void BM_PlaceBookLayout(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    const shared_ptr<const LayoutBook> book = findLayoutBook(config);
+    GameRng rng(2024);
+    Player empty, player;
+
+    initFleet(empty, config);
+
+    for (auto _ : state) {
+        player = empty;
+        placeBookLayout(player, *book, rng);
+        benchmark::DoNotOptimize(player.board.cells.data());
+    }
+}
+
+BENCHMARK(BM_PlaceBookLayout)->Arg(6)->Arg(10);
+
+// checks ships of every size against placed fleets, going over the cells of
+// the board in both orientations
+void BM_IsIntersect(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    const int numCells = config.numRows * config.numCols;
+    GameRng rng(2024);
+    vector<Player> players;
+
+    for (int index = 0; index < 64; index++) {
+        players.push_back(makePlacedPlayer(config, rng));
+    }
+
+    int next = 0;
+    int cell = 0;
+
+    for (auto _ : state) {
+        next = (next + 1) % players.size();
+        cell = (cell + 7) % numCells;
+
+        bool isIntersecting = isIntersect(players[next], (cell & 1) ? 'V' : 'H', cell / config.numCols, cell % config.numCols, 2 + cell % 4);
+        benchmark::DoNotOptimize(isIntersecting);
+    }
+}
+
+BENCHMARK(BM_IsIntersect)->Arg(6)->Arg(10);
+
+// fires at the cells of a placed fleet. the cell and the fleet are put back
+// after every shot, so no ship ever sinks
+void BM_CheckForHit(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    const int numCells = config.numRows * config.numCols;
+    GameRng rng(2024);
+    Player player = makePlacedPlayer(config, rng);
+
+    int cell = 0;
+
+    for (auto _ : state) {
+        cell = (cell + 7) % numCells;
+
+        int row = cell / config.numCols;
+        int col = cell % config.numCols;
+        char loc = player.board[row][col];
+        int fleetSize = player.fleet.size();
+        bool hasShipSunk = false;
+
+        if (checkForHit(player, fleetSize, row, col, 'X', 'O', true, hasShipSunk, false)) {
+            player.fleet[player.shipIds[row][col]].hitCount--;
+        }
+
+        player.board[row][col] = loc;
+    }
+}
+
+BENCHMARK(BM_CheckForHit)->Arg(6)->Arg(10);
+
+// reads shots from a script file and parses them, the way a scripted game
+// answers 'Fire a shot:'. the file is read again from the start with the
+// timer stopped once every shot in it has been read
+void BM_ScriptedShot(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    const string path = "game_bench_shots.txt";
+
+    {
+        ofstream script(path);
+
+        for (int round = 0; round < 1000; round++) {
+            for (int row = 0; row < config.numRows; row++) {
+                for (int col = 0; col < config.numCols; col++) {
+                    script << rowLabel(row) << col + 1 << "\n";
+                }
+            }
+        }
+    }
+
+    InputSource input;
+    string coordinate;
+
+    openInputFile(input, path);
+
+    for (auto _ : state) {
+        if (!readToken(input, coordinate)) {
+            state.PauseTiming();
+            closeInput(input);
+            openInputFile(input, path);
+            readToken(input, coordinate);
+            state.ResumeTiming();
+        }
+
+        int row, col;
+        bool isValid = isValidCoordinate(coordinate, row, col, config.numRows, config.numCols);
+        benchmark::DoNotOptimize(isValid);
+    }
+
+    closeInput(input);
+    remove(path.c_str());
+}
+
+BENCHMARK(BM_ScriptedShot)->Arg(6)->Arg(10);
+
+// the hunt phase of the density from scratch: every placement of every ship
+// still afloat that avoids the shots, counted with the bitboards
+void BM_HuntDensity(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    vector<GameSnapshot> snapshots = makeSnapshots(config, 64, [](const GameSnapshot& game) {
+        return !game.computer.isTargeting;
+    });
+
+    vector<BitBoard> bitBoards;
+
+    for (const GameSnapshot& game : snapshots) {
+        bitBoards.push_back(makeBitBoard(game.player, game.fleetSize));
+    }
+
+    Grid<double> probabilityDensity;
+    int next = 0;
+
+    for (auto _ : state) {
+        next = (next + 1) % snapshots.size();
+
+        calculateHuntDensity(bitBoards[next], snapshots[next].player.fleet, snapshots[next].fleetSize, probabilityDensity);
+        benchmark::DoNotOptimize(probabilityDensity.cells.data());
+    }
+}
+
+BENCHMARK(BM_HuntDensity)->Arg(6)->Arg(10);
+
+// the hunt phase as the game plays it: the placement index is kept up to
+// date after every shot, so a shot is only a pick from its highest bucket
+void BM_HuntPick(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    vector<GameSnapshot> snapshots = makeSnapshots(config, 64, [](const GameSnapshot& game) {
+        return !game.computer.isTargeting;
+    });
+
+    GameRng rng(2024);
+    int next = 0;
+
+    for (auto _ : state) {
+        next = (next + 1) % snapshots.size();
+
+        int row, col;
+        bool isPicked = pickHighestDensityCell(snapshots[next].computer.placementIndex, row, col, rng);
+        benchmark::DoNotOptimize(isPicked);
+    }
+}
+
+BENCHMARK(BM_HuntPick)->Arg(6)->Arg(10);
+
+// the target phase of the density, around the hits on ships that have not
+// sunk
+void BM_TargetDensity(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    vector<GameSnapshot> snapshots = makeSnapshots(config, 64, [](const GameSnapshot& game) {
+        return game.computer.isTargeting && !game.computer.hits.empty();
+    });
+
+    GameRng rng(2024);
+    int next = 0;
+
+    for (auto _ : state) {
+        next = (next + 1) % snapshots.size();
+
+        GameSnapshot& game = snapshots[next];
+        ComputerState& computer = game.computer;
+        bool isTargeting = true;
+        Point targetShot;
+
+        calculateProbabilityDensity(game.player, game.fleetSize, computer.probabilityDensity, computer.touchedCells, computer.hits, isTargeting, targetShot, false, computer.sunkCells, rng);
+        benchmark::DoNotOptimize(targetShot);
+    }
+}
+
+BENCHMARK(BM_TargetDensity)->Arg(6)->Arg(10);
+
+// whole computer turns, picking the shot and firing it, over games played to
+// the end. a finished game is set up again with the timer stopped
+void BM_ComputerTurn(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    GameRng rng(2024);
+    Player player, placed = makePlacedPlayer(config, rng);
+    ComputerState computer;
+    int fleetSize = 0;
+
+    for (auto _ : state) {
+        if (fleetSize == 0) {
+            state.PauseTiming();
+            player = placed;
+            fleetSize = player.fleet.size();
+            resetComputerState(computer);
+            state.ResumeTiming();
+        }
+
+        bool isHit = computerTurn(player, fleetSize, computer, rng, false);
+        benchmark::DoNotOptimize(isHit);
+    }
+}
+
+BENCHMARK(BM_ComputerTurn)->Arg(6)->Arg(10);
+
+// whole headless games between two computers, counted as games per second
+void BM_FullGame(benchmark::State& state) {
+    const GameConfig config = makeBenchConfig(state.range(0));
+    GameContext context;
+    long long game = 0;
+
+    for (auto _ : state) {
+        GameRng rng = makeGameRng(2024, game++);
+
+        int winner = simulateGame(context, config, rng, nullptr);
+        benchmark::DoNotOptimize(winner);
+    }
+
+    // reported as 'items_per_second'
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_FullGame)->Arg(6)->Arg(10);
+
+BENCHMARK_MAIN();
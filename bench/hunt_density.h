@@ -0,0 +1,240 @@
+#pragma once
+
+#include "header.h"
+
+// the hunt density computed from scratch with bitboards and bit-sliced
+// counters. the game used it until the placement index took over the hunt,
+// which keeps the density up to date from shot to shot, so it is kept for
+// 'game_bench.cpp' and 'kernels_bench.cpp' only, as the runtime sized
+// kernel the other paths are measured against
+
+// number of bit-sliced counter planes used for the density, enough for a
+// density of up to 2^32 - 1 per cell. a cell is covered by at most twice
+// the size of a ship placements of that ship, each adding its size, so the
+// density is at most twice the largest ship size times the cells of the
+// fleet. on a board of at most 1000x1000 that stays below 2 * 10^9
+const int DENSITY_PLANES = 32;
+
+// a player's board split into bit planes
+struct BitBoard {
+    BitLayout layout;
+    BitMask hit;
+    BitMask miss;
+    BitMask ship;
+    BitMask sunk;
+};
+
+// function builds the bitboard of a player's board. the 'hit' and 'miss'
+// planes come from the 'X' and 'O' marks and the 'ship' plane from the
+// fleet. the ships past the first 'fleetSize' are the ones that sank, which
+// 'removeShip()' moves to the end, and also make up the 'sunk' plane
+inline BitBoard makeBitBoard(const Player& player, int fleetSize) {
+    const BitLayout layout = makeBitLayout(player.board.numRows, player.board.numCols);
+
+    BitBoard bitBoard = {layout, emptyMask(layout), emptyMask(layout), emptyMask(layout), emptyMask(layout)};
+
+    for (int row = 0; row < layout.numRows; row++) {
+        for (int col = 0; col < layout.numCols; col++) {
+            if (player.board[row][col] == 'X') {
+                setBit(layout, bitBoard.hit, row, col);
+            } else if (player.board[row][col] == 'O') {
+                setBit(layout, bitBoard.miss, row, col);
+            }
+        }
+    }
+
+    for (int shipIndex = 0; shipIndex < (int)player.fleet.size(); shipIndex++) {
+        for (const Point& point : player.fleet[shipIndex].points) {
+            setBit(layout, bitBoard.ship, point.rowIndex, point.colIndex);
+
+            if (shipIndex >= fleetSize) {
+                setBit(layout, bitBoard.sunk, point.rowIndex, point.colIndex);
+            }
+        }
+    }
+
+    return bitBoard;
+}
+
+// the kernel works on arrays of 64-bit words. 'FIXED_WORDS' is the number of
+// words when it is known at compile time, which lets the compiler fully
+// unroll the loops for the common board sizes, or 0 to use 'numWords'
+template <int FIXED_WORDS>
+struct HuntDensityKernel {
+    // function checks if every word is zero
+    static bool isZero(const uint64_t* words, int numWords) {
+        uint64_t any = 0;
+
+        for (int word = 0; word < numWords; word++) {
+            any |= words[word];
+        }
+
+        return any == 0;
+    }
+
+    // function moves every bit 'shift' positions towards bit 0, so that bit
+    // 'i' of 'result' is bit 'i + shift' of 'words'
+    static void shiftRight(uint64_t* result, const uint64_t* words, int shift, int numWords) {
+        const int wordShift = shift / 64;
+        const int bitShift = shift % 64;
+
+        for (int word = 0; word < numWords; word++) {
+            uint64_t low = (word + wordShift < numWords) ? words[word + wordShift] : 0;
+            uint64_t high = (word + wordShift + 1 < numWords) ? words[word + wordShift + 1] : 0;
+
+            result[word] = (bitShift == 0) ? low : (low >> bitShift) | (high << (64 - bitShift));
+        }
+    }
+
+    // function moves every bit 'shift' positions away from bit 0, so that
+    // bit 'i' of 'result' is bit 'i - shift' of 'words'
+    static void shiftLeft(uint64_t* result, const uint64_t* words, int shift, int numWords) {
+        const int wordShift = shift / 64;
+        const int bitShift = shift % 64;
+
+        for (int word = numWords - 1; word >= 0; word--) {
+            uint64_t high = (word - wordShift >= 0) ? words[word - wordShift] : 0;
+            uint64_t low = (word - wordShift - 1 >= 0) ? words[word - wordShift - 1] : 0;
+
+            result[word] = (bitShift == 0) ? high : (high << bitShift) | (low >> (64 - bitShift));
+        }
+    }
+
+    // function stores in 'starts' the cells where a ship of 'shipSize' can
+    // start so that every cell it covers is in 'freeCells'. a vertical ship
+    // steps a whole row at a time, so the free cells are shifted by the row
+    // stride instead of by one. runs that leave the board hit a guard bit or
+    // the clear bits past the last row and drop out on their own
+    static void placementStarts(const BitLayout& layout, const uint64_t* freeCells, int shipSize, char orientation, uint64_t* starts, uint64_t* shifted, int numWords) {
+        const int step = (orientation == 'V') ? layout.stride : 1;
+
+        for (int word = 0; word < numWords; word++) {
+            starts[word] = freeCells[word];
+        }
+
+        for (int offset = 1; offset < shipSize && !isZero(starts, numWords); offset++) {
+            shiftRight(shifted, freeCells, offset * step, numWords);
+
+            for (int word = 0; word < numWords; word++) {
+                starts[word] &= shifted[word];
+            }
+        }
+    }
+
+    // function adds 'weight' to the counter of every cell in 'mask'. the
+    // counters are bit-sliced, plane 'p' of 'planes' holds bit 'p' of every
+    // cell's counter, so a whole mask is added with a few AND/XOR operations
+    // per plane no matter how many cells it covers
+    static void addToPlanes(uint64_t* planes, const uint64_t* mask, int weight, uint64_t* carry, uint64_t* nextCarry, int numWords) {
+        for (int bit = 0; weight != 0 && bit < DENSITY_PLANES; bit++, weight >>= 1) {
+            if ((weight & 1) == 0) {
+                continue;
+            }
+
+            // ripple-carry add of 'mask' starting at plane 'bit'
+            for (int word = 0; word < numWords; word++) {
+                carry[word] = mask[word];
+            }
+
+            for (int plane = bit; plane < DENSITY_PLANES && !isZero(carry, numWords); plane++) {
+                uint64_t* counter = planes + plane * numWords;
+
+                for (int word = 0; word < numWords; word++) {
+                    nextCarry[word] = counter[word] & carry[word];
+                    counter[word] ^= carry[word];
+                }
+
+                swap(carry, nextCarry);
+            }
+        }
+    }
+
+    // function computes the hunt mode density of every cell. for every ship
+    // and orientation the legal starting cells are found with shifts and
+    // ANDs, and the cells covered by those placements are accumulated in
+    // bit-sliced counters. each placement adds the size of the ship to the
+    // cells it covers, which matches the weighting the density has always
+    // used. shot cells end up with a density of zero
+    static void run(const BitBoard& bitBoard, const vector<Ship>& fleet, int fleetSize, Grid<double>& probabilityDensity) {
+        const char orientations[2] = {'V', 'H'};
+        const BitLayout& layout = bitBoard.layout;
+        const int numWords = (FIXED_WORDS > 0) ? FIXED_WORDS : layout.numWords;
+
+        // scratch masks live in one buffer that is kept between calls. the
+        // fixed size kernels may run over more words than the board needs,
+        // the extra words simply stay zero
+        thread_local vector<uint64_t> scratch;
+        scratch.assign((DENSITY_PLANES + 6) * numWords, 0);
+
+        uint64_t* planes = scratch.data();
+        uint64_t* freeCells = planes + DENSITY_PLANES * numWords;
+        uint64_t* starts = freeCells + numWords;
+        uint64_t* shifted = starts + numWords;
+        uint64_t* covered = shifted + numWords;
+        uint64_t* carry = covered + numWords;
+        uint64_t* nextCarry = carry + numWords;
+
+        // the free cells are the cells that have not been shot
+        BitMask freeMask = maskAndNot(boardCellsMask(layout), maskOr(bitBoard.hit, bitBoard.miss));
+
+        copy(freeMask.words.begin(), freeMask.words.end(), freeCells);
+
+        for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
+            const int shipSize = fleet[shipIndex].size;
+
+            for (char orientation : orientations) {
+                const int step = (orientation == 'V') ? layout.stride : 1;
+
+                placementStarts(layout, freeCells, shipSize, orientation, starts, shifted, numWords);
+
+                // every placement covers its starting cell and the next
+                // 'shipSize - 1' cells along its orientation
+                for (int offset = 0; offset < shipSize && !isZero(starts, numWords); offset++) {
+                    shiftLeft(covered, starts, offset * step, numWords);
+                    addToPlanes(planes, covered, shipSize, carry, nextCarry, numWords);
+                }
+            }
+        }
+
+        // reads the counters back out into the density grid. the planes
+        // above the highest one with a bit set are all zero and are skipped
+        int numPlanes = DENSITY_PLANES;
+
+        while (numPlanes > 0 && isZero(planes + (numPlanes - 1) * numWords, numWords)) {
+            numPlanes--;
+        }
+
+        probabilityDensity.resize(layout.numRows, layout.numCols, 0.0);
+
+        for (int row = 0; row < layout.numRows; row++) {
+            for (int col = 0; col < layout.numCols; col++) {
+                int index = row * layout.stride + col;
+                uint32_t count = 0;
+
+                for (int plane = 0; plane < numPlanes; plane++) {
+                    count |= uint32_t((planes[plane * numWords + index / 64] >> (index % 64)) & 1) << plane;
+                }
+
+                probabilityDensity[row][col] = count;
+            }
+        }
+    }
+};
+
+// function computes the hunt mode density with the bitboard kernel. boards
+// that fit in one, two or four words (up to 8x7, 10x10 and 15x15) get a copy
+// of the kernel with the word count fixed at compile time, larger boards use
+// the generic one
+inline void calculateHuntDensity(const BitBoard& bitBoard, const vector<Ship>& fleet, int fleetSize, Grid<double>& probabilityDensity) {
+    const int numWords = bitBoard.layout.numWords;
+
+    if (numWords <= 1) {
+        HuntDensityKernel<1>::run(bitBoard, fleet, fleetSize, probabilityDensity);
+    } else if (numWords <= 2) {
+        HuntDensityKernel<2>::run(bitBoard, fleet, fleetSize, probabilityDensity);
+    } else if (numWords <= 4) {
+        HuntDensityKernel<4>::run(bitBoard, fleet, fleetSize, probabilityDensity);
+    } else {
+        HuntDensityKernel<0>::run(bitBoard, fleet, fleetSize, probabilityDensity);
+    }
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <array>
+#include <utility>
+
+#include "header.h"
+
+// board kernels specialised at compile time for one board size and fleet.
+// every placement mask is generated with constexpr, and the loops over the
+// placements and the ship cells have fixed trip counts, so the compiler can
+// unroll them completely. they are an experiment for 'kernels_bench.cpp'
+// only: the game hunts with the placement index and always takes the
+// runtime sized functions in functions.cpp, and the runtime sized density
+// they are checked against is in 'hunt_density.h'
+
+// a set of cells of a board with 'NUM_CELLS' cells, cell 'row * numCols +
+// col' is bit 'cell % 64' of word 'cell / 64'
+template <int NUM_CELLS>
+struct CellMask {
+    static constexpr int NUM_WORDS = (NUM_CELLS + 63) / 64;
+
+    uint64_t words[NUM_WORDS] = {};
+
+    constexpr void set(int cell) {
+        words[cell / 64] |= uint64_t(1) << (cell % 64);
+    }
+
+    constexpr bool test(int cell) const {
+        return (words[cell / 64] >> (cell % 64)) & 1;
+    }
+
+    constexpr bool intersects(const CellMask& other) const {
+        uint64_t common = 0;
+
+        for (int word = 0; word < NUM_WORDS; word++) {
+            common |= words[word] & other.words[word];
+        }
+
+        return common != 0;
+    }
+};
+
+// every placement of a ship of 'SIZE' on a 'ROWS' by 'COLS' board, the
+// horizontal ones row by row first and then the vertical ones, in the same
+// order the placement table numbers them
+template <int ROWS, int COLS, int SIZE>
+struct FixedPlacements {
+    static constexpr int NUM_HORIZONTAL = (SIZE <= COLS) ? ROWS * (COLS - SIZE + 1) : 0;
+    static constexpr int NUM_VERTICAL = (SIZE <= ROWS) ? (ROWS - SIZE + 1) * COLS : 0;
+    static constexpr int COUNT = NUM_HORIZONTAL + NUM_VERTICAL;
+
+    struct Entry {
+        CellMask<ROWS * COLS> mask;
+        int firstCell = 0;
+        int step = 0;
+    };
+
+    static constexpr array<Entry, COUNT> build() {
+        array<Entry, COUNT> entries = {};
+        int placement = 0;
+
+        for (int row = 0; row < ROWS && SIZE <= COLS; row++) {
+            for (int col = 0; col + SIZE <= COLS; col++, placement++) {
+                entries[placement].firstCell = row * COLS + col;
+                entries[placement].step = 1;
+            }
+        }
+
+        for (int row = 0; row + SIZE <= ROWS; row++) {
+            for (int col = 0; col < COLS; col++, placement++) {
+                entries[placement].firstCell = row * COLS + col;
+                entries[placement].step = COLS;
+            }
+        }
+
+        for (Entry& entry : entries) {
+            for (int offset = 0; offset < SIZE; offset++) {
+                entry.mask.set(entry.firstCell + offset * entry.step);
+            }
+        }
+
+        return entries;
+    }
+
+    static constexpr array<Entry, COUNT> entries = build();
+};
+
+// the kernels for a 'ROWS' by 'COLS' board and a fleet with ships of
+// 'SHIP_SIZES', listed in the order of the ships file
+template <int ROWS, int COLS, int... SHIP_SIZES>
+struct FixedKernels {
+    static constexpr int NUM_ROWS = ROWS;
+    static constexpr int NUM_COLS = COLS;
+    static constexpr int NUM_CELLS = ROWS * COLS;
+    static constexpr int NUM_SHIPS = sizeof...(SHIP_SIZES);
+    static constexpr int MAX_SHIP_SIZE = max({SHIP_SIZES...});
+
+    typedef CellMask<NUM_CELLS> Mask;
+
+    // a fleet's cells, one mask per ship and one for the whole fleet
+    struct FleetMasks {
+        Mask occupied;
+        Mask ships[NUM_SHIPS];
+    };
+
+    // function returns how many ships of the fleet have 'shipSize'
+    static constexpr int countShipsOfSize(int shipSize) {
+        int count = 0;
+
+        for (int size : {SHIP_SIZES...}) {
+            count += (size == shipSize);
+        }
+
+        return count;
+    }
+
+    // the cells a ship of every size up to the largest one covers from every
+    // starting cell, cut off at the edges of the board
+    struct LineMasks {
+        Mask lines[2][MAX_SHIP_SIZE + 1][NUM_CELLS];
+    };
+
+    static constexpr LineMasks buildLineMasks() {
+        LineMasks table = {};
+
+        for (int vertical = 0; vertical < 2; vertical++) {
+            for (int size = 1; size <= MAX_SHIP_SIZE; size++) {
+                for (int cell = 0; cell < NUM_CELLS; cell++) {
+                    int row = cell / COLS;
+                    int col = cell % COLS;
+
+                    for (int offset = 0; offset < size; offset++) {
+                        if (vertical && row + offset < ROWS) {
+                            table.lines[vertical][size][cell].set((row + offset) * COLS + col);
+                        } else if (!vertical && col + offset < COLS) {
+                            table.lines[vertical][size][cell].set(row * COLS + col + offset);
+                        }
+                    }
+                }
+            }
+        }
+
+        return table;
+    }
+
+    static constexpr LineMasks lineMasks = buildLineMasks();
+
+    // function checks if the ship will go out of bounds
+    static constexpr bool isShipOutOfBounds(char orientation, int shipRowIndex, int shipColIndex, int shipSize) {
+        return ((orientation == 'V') ? shipRowIndex : shipColIndex) + shipSize > ((orientation == 'V') ? ROWS : COLS);
+    }
+
+    // function builds the masks of the ships in a player's fleet
+    static FleetMasks makeFleetMasks(const Player& player) {
+        FleetMasks fleet;
+
+        for (int shipIndex = 0; shipIndex < NUM_SHIPS; shipIndex++) {
+            for (const Point& point : player.fleet[shipIndex].points) {
+                int cell = point.rowIndex * COLS + point.colIndex;
+
+                fleet.ships[shipIndex].set(cell);
+                fleet.occupied.set(cell);
+            }
+        }
+
+        return fleet;
+    }
+
+    // function checks if a ship of 'shipSize' placed at 'shipRowIndex',
+    // 'shipColIndex' would intersect any ship of the fleet. 'shipSize' can
+    // not be larger than the largest ship of the fleet
+    static bool isIntersect(const FleetMasks& fleet, char orientation, int shipRowIndex, int shipColIndex, int shipSize) {
+        const Mask& line = lineMasks.lines[orientation == 'V'][shipSize][shipRowIndex * COLS + shipColIndex];
+
+        return line.intersects(fleet.occupied);
+    }
+
+    // function returns the index of the ship at 'shotRowIndex',
+    // 'shotColIndex', or -1 if the shot is a miss
+    static int checkForHit(const FleetMasks& fleet, int shotRowIndex, int shotColIndex) {
+        const int cell = shotRowIndex * COLS + shotColIndex;
+
+        int hitShip = -1;
+
+        for (int shipIndex = 0; shipIndex < NUM_SHIPS; shipIndex++) {
+            hitShip = fleet.ships[shipIndex].test(cell) ? shipIndex : hitShip;
+        }
+
+        return hitShip;
+    }
+
+    // function adds the placement 'PLACEMENT' of a ship of 'SIZE' to the
+    // density unless it covers a shot cell
+    template <int SIZE, size_t PLACEMENT>
+    static void addPlacementDensity(const Mask& shotCells, int weight, int* density) {
+        constexpr auto& entry = FixedPlacements<ROWS, COLS, SIZE>::entries[PLACEMENT];
+
+        const int amount = weight * !entry.mask.intersects(shotCells);
+
+        for (int offset = 0; offset < SIZE; offset++) {
+            density[entry.firstCell + offset * entry.step] += amount;
+        }
+    }
+
+    template <int SIZE, size_t... PLACEMENTS>
+    static void addSizeDensity(const Mask& shotCells, int weight, int* density, index_sequence<PLACEMENTS...>) {
+        (addPlacementDensity<SIZE, PLACEMENTS>(shotCells, weight, density), ...);
+    }
+
+    // function adds every placement of the ships of 'SIZE' that are still
+    // afloat, each one adding the ship's size to the cells it covers once
+    // for every ship of that size
+    template <int SIZE>
+    static void addShipDensity(const Mask& shotCells, const int* numAfloat, int* density) {
+        if constexpr (countShipsOfSize(SIZE) > 0) {
+            if (numAfloat[SIZE] > 0) {
+                addSizeDensity<SIZE>(shotCells, SIZE * numAfloat[SIZE], density, make_index_sequence<FixedPlacements<ROWS, COLS, SIZE>::COUNT>());
+            }
+        }
+    }
+
+    template <size_t... SIZES>
+    static void addFleetDensity(const Mask& shotCells, const int* numAfloat, int* density, index_sequence<SIZES...>) {
+        (addShipDensity<int(SIZES)>(shotCells, numAfloat, density), ...);
+    }
+
+    // function computes the hunt mode density into 'density'. 'numAfloat[s]'
+    // is the number of ships of size 's' that have not sunk. shot cells end
+    // up with a density of zero, the same as the generic kernel
+    static void huntDensity(const Mask& shotCells, const int* numAfloat, int* density) {
+        for (int cell = 0; cell < NUM_CELLS; cell++) {
+            density[cell] = 0;
+        }
+
+        addFleetDensity(shotCells, numAfloat, density, make_index_sequence<MAX_SHIP_SIZE + 1>());
+    }
+};
+
+// the standard 6x6 game and the classic 10x10 game, both with the five ships
+// of 'ships.txt'
+typedef FixedKernels<6, 6, 5, 4, 3, 3, 2> StandardKernels;
+typedef FixedKernels<10, 10, 5, 4, 3, 3, 2> ClassicKernels;
@@ -0,0 +1,235 @@
+// compares the kernels specialised at compile time in 'bench/kernels.h'
+// with the generic runtime sized paths, the bitboard density in
+// 'bench/hunt_density.h' and the checks the game uses, on the standard 6x6
+// game and the classic 10x10 game. build from the repository root with
+//
+//   g++ -std=c++17 -O2 -I. bench/kernels_bench.cpp adversary.cpp bitboard.cpp functions.cpp input.cpp instrument.cpp matchmaking.cpp montecarlo.cpp placement.cpp record.cpp render.cpp replay.cpp server.cpp session.cpp simulation.cpp solver.cpp -o kernels_bench
+//
+// and run it from there so 'ships.txt' is found
+#include "hunt_density.h"
+#include "kernels.h"
+
+// a game part way through: the player's board with some shots fired at it
+struct BenchState {
+    Player player;
+    int fleetSize;
+};
+
+// function builds 'numStates' random game states with up to a third of the
+// board shot
+vector<BenchState> makeBenchStates(const GameConfig& config, int numStates, GameRng& rng) {
+    vector<BenchState> states(numStates);
+    Player other;
+
+    for (BenchState& state : states) {
+        initFleet(state.player, config);
+        initFleet(other, config);
+        computerStartShipPlacement(other, state.player, rng);
+
+        // the fleet keeps its placement order so it lines up with the
+        // fixed fleet, ships are only counted as sunk
+        Player shotAt = state.player;
+        int numShips = shotAt.fleet.size();
+        int numShots = randomBelow(rng, config.numRows * config.numCols / 3 + 1);
+        bool hasShipSunk = false;
+
+        for (int shot = 0; shot < numShots && numShips > 0; shot++) {
+            int row = randomBelow(rng, config.numRows);
+            int col = randomBelow(rng, config.numCols);
+
+            if (shotAt.board[row][col] != 'X' && shotAt.board[row][col] != 'O') {
+                checkForHit(shotAt, numShips, row, col, 'X', 'O', true, hasShipSunk, false);
+            }
+        }
+
+        // only the shot board and the number of ships afloat are taken
+        // over, the fleet stays whole
+        state.player.board = shotAt.board;
+        state.fleetSize = numShips;
+    }
+
+    return states;
+}
+
+// function runs 'operation' over and over for roughly a quarter of a second
+// and prints the average time per call
+void runBenchmark(const string& name, const function<void()>& operation) {
+    const double minSeconds = 0.25;
+
+    long long numCalls = 0;
+    auto start = chrono::steady_clock::now();
+    chrono::duration<double> elapsed(0);
+
+    while (elapsed.count() < minSeconds) {
+        for (int repeat = 0; repeat < 1000; repeat++) {
+            operation();
+        }
+
+        numCalls += 1000;
+        elapsed = chrono::steady_clock::now() - start;
+    }
+
+    cout << "  " << left << setw(36) << name << right << setw(10) << fixed << setprecision(1) << elapsed.count() * 1e9 / numCalls << " ns\n";
+}
+
+template <typename Kernels>
+void benchmarkBoard(const string& title, GameRng& rng) {
+    typedef typename Kernels::Mask Mask;
+
+    GameConfig config;
+    config.numRows = Kernels::NUM_ROWS;
+    config.numCols = Kernels::NUM_COLS;
+
+    vector<BenchState> states = makeBenchStates(config, 256, rng);
+
+    // the inputs of both paths are built up front so only the kernels are
+    // timed
+    vector<BitBoard> bitBoards;
+    vector<Mask> shotMasks(states.size());
+    vector<array<int, Kernels::MAX_SHIP_SIZE + 1>> numAfloat(states.size());
+    vector<typename Kernels::FleetMasks> fleetMasks;
+    vector<vector<Ship>> afloatShips(states.size());
+
+    for (size_t index = 0; index < states.size(); index++) {
+        const BenchState& state = states[index];
+
+        bitBoards.push_back(makeBitBoard(state.player, state.player.fleet.size()));
+        fleetMasks.push_back(Kernels::makeFleetMasks(state.player));
+
+        for (int cell = 0; cell < Kernels::NUM_CELLS; cell++) {
+            char loc = state.player.board[cell / Kernels::NUM_COLS][cell % Kernels::NUM_COLS];
+
+            if (loc == 'X' || loc == 'O') {
+                shotMasks[index].set(cell);
+            }
+        }
+
+        numAfloat[index].fill(0);
+
+        // the generic kernel takes the ships that are still afloat, the
+        // specialised one how many of each size are
+        for (const Ship& ship : state.player.fleet) {
+            if (ship.hitCount < ship.size) {
+                afloatShips[index].push_back(ship);
+                numAfloat[index][ship.size]++;
+            }
+        }
+    }
+
+    // both paths have to agree before their speed means anything
+    Grid<double> genericDensity;
+    int fixedDensity[Kernels::NUM_CELLS];
+
+    for (size_t index = 0; index < states.size(); index++) {
+        const BenchState& state = states[index];
+
+        calculateHuntDensity(bitBoards[index], afloatShips[index], afloatShips[index].size(), genericDensity);
+        Kernels::huntDensity(shotMasks[index], numAfloat[index].data(), fixedDensity);
+
+        for (int cell = 0; cell < Kernels::NUM_CELLS; cell++) {
+            int row = cell / Kernels::NUM_COLS;
+            int col = cell % Kernels::NUM_COLS;
+
+            for (char orientation : {'V', 'H'}) {
+                if (isIntersect(state.player, orientation, row, col, 3) != Kernels::isIntersect(fleetMasks[index], orientation, row, col, 3)) {
+                    cout << "isIntersect differs on the " << title << " board\n";
+                    exit(1);
+                }
+            }
+
+            if (genericDensity[row][col] != fixedDensity[cell]) {
+                cout << "Hunt density differs on the " << title << " board\n";
+                exit(1);
+            }
+        }
+    }
+
+    cout << title << ":\n";
+
+    size_t next = 0;
+    long long sink = 0;
+
+    runBenchmark("hunt density, generic", [&]() {
+        next = (next + 1) % states.size();
+
+        calculateHuntDensity(bitBoards[next], afloatShips[next], afloatShips[next].size(), genericDensity);
+        sink += genericDensity[0][0];
+    });
+
+    runBenchmark("hunt density, specialised", [&]() {
+        next = (next + 1) % states.size();
+
+        Kernels::huntDensity(shotMasks[next], numAfloat[next].data(), fixedDensity);
+        sink += fixedDensity[0];
+    });
+
+    int cell = 0;
+
+    runBenchmark("isIntersect, generic", [&]() {
+        next = (next + 1) % states.size();
+        cell = (cell + 7) % Kernels::NUM_CELLS;
+
+        sink += isIntersect(states[next].player, 'H', cell / Kernels::NUM_COLS, cell % Kernels::NUM_COLS, 3);
+    });
+
+    runBenchmark("isIntersect, specialised", [&]() {
+        next = (next + 1) % states.size();
+        cell = (cell + 7) % Kernels::NUM_CELLS;
+
+        sink += Kernels::isIntersect(fleetMasks[next], 'H', cell / Kernels::NUM_COLS, cell % Kernels::NUM_COLS, 3);
+    });
+
+    runBenchmark("isShipOutOfBounds, generic", [&]() {
+        cell = (cell + 7) % Kernels::NUM_CELLS;
+
+        sink += isShipOutOfBounds('V', cell / Kernels::NUM_COLS, cell % Kernels::NUM_COLS, 4, config.numRows, config.numCols);
+    });
+
+    runBenchmark("isShipOutOfBounds, specialised", [&]() {
+        cell = (cell + 7) % Kernels::NUM_CELLS;
+
+        sink += Kernels::isShipOutOfBounds('V', cell / Kernels::NUM_COLS, cell % Kernels::NUM_COLS, 4);
+    });
+
+    // the generic check marks the board and counts the hit, so a copy of the
+    // state is shot at and the cell and hit count are put back afterwards
+    BenchState scratch = states[0];
+
+    runBenchmark("checkForHit, generic", [&]() {
+        cell = (cell + 7) % Kernels::NUM_CELLS;
+
+        int row = cell / Kernels::NUM_COLS;
+        int col = cell % Kernels::NUM_COLS;
+        char loc = scratch.player.board[row][col];
+        int numShips = Kernels::NUM_SHIPS;
+        bool hasShipSunk = false;
+
+        if (checkForHit(scratch.player, numShips, row, col, 'X', 'O', false, hasShipSunk, false)) {
+            sink++;
+            scratch.player.fleet = states[0].player.fleet;
+        }
+
+        scratch.player.board[row][col] = loc;
+    });
+
+    typename Kernels::FleetMasks scratchMasks = Kernels::makeFleetMasks(scratch.player);
+
+    runBenchmark("checkForHit, specialised", [&]() {
+        cell = (cell + 7) % Kernels::NUM_CELLS;
+
+        sink += Kernels::checkForHit(scratchMasks, cell / Kernels::NUM_COLS, cell % Kernels::NUM_COLS);
+    });
+
+    if (sink == 42) {
+        cout << "\n";
+    }
+}
+
+int main() {
+    GameRng rng(2024);
+
+    benchmarkBoard<StandardKernels>("Standard 6x6 board", rng);
+    benchmarkBoard<ClassicKernels>("Classic 10x10 board", rng);
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+// a load test of the matchmaker. '--producers' threads queue tickets for
+// '--players' players, '--computer' percent of them for a game against the
+// computer and the rest for a game against another player, while
+// '--workers' threads pair them. the queue has room for '--capacity'
+// tickets, a producer that finds it full tries again. every player has to
+// be paired exactly once, except a last one left without an opponent. build
+// from the repository root with
+//
+//   g++ -std=c++17 -O2 -I. bench/matchmaking_bench.cpp adversary.cpp bitboard.cpp functions.cpp input.cpp instrument.cpp matchmaking.cpp montecarlo.cpp placement.cpp record.cpp render.cpp replay.cpp server.cpp session.cpp simulation.cpp solver.cpp -lpthread -o matchmaking_bench
+//
+// the program fails if a player is paired twice or not at all
+#include "header.h"
+
+// function decides whether 'player' asks for a game against the computer,
+// the same way every run
+bool isComputerGame(uint32_t player, int computerPercent) {
+    return (uint32_t)(player * 2654435761u) % 100 < (uint32_t)computerPercent;
+}
+
+int main(int argc, char* argv[]) {
+    int numPlayers = 1000000;
+    int numProducers = 2;
+    int numWorkers = 2;
+    int computerPercent = 25;
+    int capacity = 4096;
+
+    for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2) {
+        string option = argv[argIndex];
+
+        if (option == "--players") {
+            numPlayers = max(2, atoi(argv[argIndex + 1]));
+        } else if (option == "--producers") {
+            numProducers = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--workers") {
+            numWorkers = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--computer") {
+            computerPercent = min(100, max(0, atoi(argv[argIndex + 1])));
+        } else if (option == "--capacity") {
+            capacity = max(2, atoi(argv[argIndex + 1]));
+        }
+    }
+
+    // every player but a last one without an opponent gets paired
+    int numVersusPlayers = 0;
+
+    for (int player = 0; player < numPlayers; player++) {
+        numVersusPlayers += !isComputerGame(player, computerPercent);
+    }
+
+    const long long expectedPaired = numPlayers - numVersusPlayers % 2;
+
+    Matchmaker matchmaker;
+    vector<atomic<uint8_t>> timesPaired(numPlayers);
+    atomic<long long> numPaired(0);
+    atomic<long long> numFullQueue(0);
+
+    openMatchmaker(matchmaker, capacity);
+
+    for (atomic<uint8_t>& times : timesPaired) {
+        times.store(0, memory_order_relaxed);
+    }
+
+    vector<MatchmakingStats> workerStats(numWorkers);
+    vector<thread> threads;
+
+    auto start = chrono::steady_clock::now();
+
+    for (int producer = 0; producer < numProducers; producer++) {
+        threads.emplace_back([&, producer]() {
+            for (int player = producer; player < numPlayers; player += numProducers) {
+                uint32_t queuedAt;
+
+                while (!queueMatchTicket(matchmaker, player, isComputerGame(player, computerPercent) ? 2 : 1, queuedAt)) {
+                    numFullQueue.fetch_add(1, memory_order_relaxed);
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (int worker = 0; worker < numWorkers; worker++) {
+        threads.emplace_back([&, worker]() {
+            auto markPaired = [&](const MatchTicket& first, const MatchTicket* second) {
+                timesPaired[first.player].fetch_add(1, memory_order_relaxed);
+
+                if (second != nullptr) {
+                    timesPaired[second->player].fetch_add(1, memory_order_relaxed);
+                }
+
+                numPaired.fetch_add(second != nullptr ? 2 : 1, memory_order_relaxed);
+            };
+
+            while (numPaired.load(memory_order_relaxed) < expectedPaired) {
+                if (pairMatchTickets(matchmaker, workerStats[worker], 256, markPaired) == 0) {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // samples the depth of the queue while the players are paired
+    long long depthTotal = 0;
+    long long numDepthSamples = 0;
+
+    while (numPaired.load(memory_order_relaxed) < expectedPaired) {
+        depthTotal += matchQueueDepth(matchmaker.queue);
+        numDepthSamples++;
+
+        this_thread::sleep_for(chrono::microseconds(200));
+    }
+
+    for (thread& benchThread : threads) {
+        benchThread.join();
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    MatchmakingStats stats;
+
+    for (const MatchmakingStats& other : workerStats) {
+        mergeMatchmakingStats(stats, other);
+    }
+
+    long long numTwice = 0;
+    long long numUnpaired = 0;
+
+    for (const atomic<uint8_t>& times : timesPaired) {
+        numTwice += times.load() > 1;
+        numUnpaired += times.load() == 0;
+    }
+
+    const long long numMatches = stats.numPlayerMatches + stats.numComputerMatches;
+
+    cout << fixed << setprecision(2);
+    cout << "Players: " << numPlayers << " from " << numProducers << " threads, paired by " << numWorkers << " threads, " << computerPercent << "% against the computer\n";
+    cout << "Matches: " << numMatches << " in " << elapsed.count() << "s (" << numMatches / elapsed.count() << " matches/s), " << stats.numPlayerMatches << " between players, " << stats.numComputerMatches << " against the computer\n";
+    cout << "Queue depth: mean " << (double)depthTotal / max(1LL, numDepthSamples) << ", max " << matchmaker.maxDepth << " of " << matchmaker.queue.mask + 1 << ", found full " << numFullQueue << " times\n";
+    cout << "Wait to be paired (us): p50 " << latencyAtPercentile(stats.pairingLatency, 50) / 1000.0 << ", p99 " << latencyAtPercentile(stats.pairingLatency, 99) / 1000.0 << ", max " << stats.pairingLatency.maxValue / 1000.0 << "\n";
+
+    if (numTwice > 0 || numUnpaired != numPlayers - expectedPaired) {
+        cout << "Paired twice: " << numTwice << ", not paired: " << numUnpaired << "\n";
+        return 1;
+    }
+
+    return 0;
+}
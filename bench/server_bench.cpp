@@ -0,0 +1,324 @@
+// a load test of the game server over loopback. it connects '--clients'
+// clients and has each of them play '--games' games of '--mode' (1 for
+// player vs player, where the clients play each other, or 2 for player vs
+// computer), all multiplexed on one thread. every client places its fleet
+// one ship per row and fires at the cells in a random order. the server
+// runs on a thread of its own unless '--port' points at one that is already
+// running, such as
+//
+//   ./battleship --serve 5000
+//
+// which leaves room for more clients in one process. build from the
+// repository root with
+//
+//   g++ -std=c++17 -O2 -I. bench/server_bench.cpp adversary.cpp bitboard.cpp functions.cpp input.cpp instrument.cpp matchmaking.cpp montecarlo.cpp placement.cpp record.cpp render.cpp replay.cpp server.cpp session.cpp simulation.cpp solver.cpp -lpthread -o server_bench
+//
+// and run it from there so 'ships.txt' is found. the program fails if the
+// server rejects a command or a game does not finish
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "header.h"
+
+// a client of the load test
+struct BenchClient {
+    int descriptor = -1;
+    string input;
+    int numRows = 0;
+    int numCols = 0;
+    // the cells to fire at, in order
+    vector<int> shots;
+    int nextShot = 0;
+    int nextShip = 0;
+    int gamesLeft = 0;
+    bool isAwaitingShot = false;
+    chrono::steady_clock::time_point firedAt;
+};
+
+// what the clients saw
+struct BenchResults {
+    long long numGames = 0;
+    long long numShots = 0;
+    long long numErrors = 0;
+    long long numLeft = 0;
+    long long numAborted = 0;
+    int numDone = 0;
+    LatencyHistogram shotLatency;
+};
+
+// function sends 'line' to 'client'. the lines are short and a client
+// waits for the answer to each, so the socket always has room for it
+void sendClientLine(BenchClient& client, const string& line) {
+    string text = line + "\n";
+
+    if (send(client.descriptor, text.data(), text.length(), MSG_NOSIGNAL) != (ssize_t)text.length()) {
+        cout << "A client could not send: " << line << "\n";
+        exit(1);
+    }
+}
+
+// function handles a line the server sent to 'client'
+void handleServerLine(BenchClient& client, const string& line, int gameMode, GameRng& rng, BenchResults& results) {
+    istringstream words(line);
+    string command;
+
+    words >> command;
+
+    if (command == "BATTLESHIP") {
+        words >> client.numRows >> client.numCols;
+        sendClientLine(client, "MODE " + to_string(gameMode));
+    } else if (command == "START") {
+        // a new order of shots for every game
+        client.shots.resize(client.numRows * client.numCols);
+
+        for (int cell = 0; cell < (int)client.shots.size(); cell++) {
+            client.shots[cell] = cell;
+        }
+
+        shuffle(client.shots.begin(), client.shots.end(), rng);
+
+        client.nextShot = 0;
+        client.nextShip = 0;
+    } else if (command == "SHIP") {
+        sendClientLine(client, "PLACE " + rowLabel(client.nextShip++) + "1 H");
+    } else if (command == "TURN") {
+        const int cell = client.shots[client.nextShot++];
+
+        client.isAwaitingShot = true;
+        client.firedAt = chrono::steady_clock::now();
+
+        sendClientLine(client, "FIRE " + rowLabel(cell / client.numCols) + to_string(cell % client.numCols + 1));
+    } else if (command == "SHOT") {
+        if (client.isAwaitingShot) {
+            recordLatency(results.shotLatency, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - client.firedAt).count());
+            client.isAwaitingShot = false;
+        }
+
+        results.numShots++;
+    } else if (command == "WIN" || command == "LOSE" || command == "LEFT" || command == "ABORT") {
+        if (command == "LEFT") {
+            results.numLeft++;
+        } else if (command == "ABORT") {
+            results.numAborted++;
+        } else {
+            results.numGames++;
+        }
+
+        if (--client.gamesLeft > 0) {
+            sendClientLine(client, "MODE " + to_string(gameMode));
+        } else {
+            shutdown(client.descriptor, SHUT_WR);
+        }
+    } else if (command == "ERR") {
+        results.numErrors++;
+
+        if (results.numErrors <= 5) {
+            cout << "The server sent: " << line << "\n";
+        }
+    }
+}
+
+// function connects a client to the server at 'port'. the connection is
+// made blocking so a full accept queue only slows it down, and the socket is
+// made non-blocking after
+int connectClient(int port) {
+    sockaddr_in address = {};
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int descriptor = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (descriptor < 0 || connect(descriptor, (sockaddr*)&address, sizeof(address)) != 0) {
+        return -1;
+    }
+
+    int isNoDelay = 1;
+
+    setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &isNoDelay, sizeof(isNoDelay));
+    fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+
+    return descriptor;
+}
+
+int main(int argc, char* argv[]) {
+    const int maxEvents = 256;
+    const double stallSeconds = 10;
+
+    int numClients = 2000;
+    int numGames = 5;
+    int gameMode = 2;
+    int port = -1;
+    GameConfig config;
+
+    for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2) {
+        string option = argv[argIndex];
+
+        if (option == "--clients") {
+            numClients = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--games") {
+            numGames = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--mode") {
+            gameMode = (atoi(argv[argIndex + 1]) == 1) ? 1 : 2;
+        } else if (option == "--port") {
+            port = atoi(argv[argIndex + 1]);
+        } else if (option == "--ships") {
+            config.shipsFile = argv[argIndex + 1];
+        }
+    }
+
+    // player vs player needs the clients in pairs
+    if (gameMode == 1) {
+        numClients += numClients % 2;
+    }
+
+    GameServer server;
+    thread serverThread;
+
+    if (port < 0) {
+        auto fleetTemplate = make_shared<FleetTemplate>();
+        string error;
+
+        if (!loadFleetTemplate(*fleetTemplate, config.shipsFile, error)) {
+            cout << error << "\n";
+            return 1;
+        }
+
+        config.fleetTemplate = fleetTemplate;
+        server.config = config;
+        server.masterSeed = 2024;
+
+        if (!openGameServer(server, "127.0.0.1", 0, error)) {
+            cout << error << "\n";
+            return 1;
+        }
+
+        port = server.port;
+        serverThread = thread(runGameServer, ref(server));
+    } else {
+        // the server usually raises its own limit, a separate one leaves it
+        // to the clients
+        rlimit limit;
+
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    vector<BenchClient> clients(numClients);
+    BenchResults results;
+    GameRng rng(2024);
+
+    auto start = chrono::steady_clock::now();
+
+    for (int clientIndex = 0; clientIndex < numClients; clientIndex++) {
+        BenchClient& client = clients[clientIndex];
+
+        client.descriptor = connectClient(port);
+        client.gamesLeft = numGames;
+
+        if (client.descriptor < 0) {
+            cout << "Client " << clientIndex + 1 << " could not connect: " << strerror(errno) << "\n";
+            return 1;
+        }
+
+        epoll_event event = {};
+
+        event.events = EPOLLIN;
+        event.data.u32 = clientIndex;
+
+        epoll_ctl(epoll, EPOLL_CTL_ADD, client.descriptor, &event);
+    }
+
+    chrono::duration<double> connectTime = chrono::steady_clock::now() - start;
+
+    epoll_event events[maxEvents];
+    char buffer[1 << 14];
+    auto lastProgress = chrono::steady_clock::now();
+
+    while (results.numDone < numClients) {
+        int numEvents = epoll_wait(epoll, events, maxEvents, 1000);
+
+        if (numEvents > 0) {
+            lastProgress = chrono::steady_clock::now();
+        } else if (chrono::duration<double>(chrono::steady_clock::now() - lastProgress).count() > stallSeconds) {
+            cout << "The games stalled with " << numClients - results.numDone << " clients still playing.\n";
+            break;
+        }
+
+        for (int eventIndex = 0; eventIndex < numEvents; eventIndex++) {
+            BenchClient& client = clients[events[eventIndex].data.u32];
+            ssize_t numRead = read(client.descriptor, buffer, sizeof(buffer));
+
+            if (numRead < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+
+            // the server closes the connection once the client has shut
+            // down its side
+            if (numRead <= 0) {
+                if (client.gamesLeft > 0) {
+                    cout << "The server dropped a client.\n";
+                    results.numErrors++;
+                }
+
+                close(client.descriptor);
+                client.descriptor = -1;
+                results.numDone++;
+                continue;
+            }
+
+            client.input.append(buffer, numRead);
+
+            size_t lineStart = 0;
+            size_t newline;
+
+            while ((newline = client.input.find('\n', lineStart)) != string::npos) {
+                handleServerLine(client, client.input.substr(lineStart, newline - lineStart), gameMode, rng, results);
+                lineStart = newline + 1;
+            }
+
+            client.input.erase(0, lineStart);
+        }
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    if (serverThread.joinable()) {
+        stopGameServer(server);
+        serverThread.join();
+        closeGameServer(server);
+    }
+
+    close(epoll);
+
+    // in player vs player games both clients see every shot and the end
+    const int numSeen = (gameMode == 1) ? 2 : 1;
+    const long long expectedGames = (long long)numClients * numGames / numSeen;
+    const long long numFinished = results.numGames / numSeen;
+    const long long numShots = results.numShots / numSeen;
+
+    cout << fixed << setprecision(2);
+    cout << "Clients: " << numClients << ", connected in " << connectTime.count() << "s, game mode " << gameMode << "\n";
+    cout << "Games: " << numFinished << " of " << expectedGames << " in " << elapsed.count() << "s (" << numFinished / elapsed.count() << " games/s)\n";
+    cout << "Shots: " << numShots << " (" << numShots / elapsed.count() << " shots/s)\n";
+    cout << "Shot round trip (us): p50 " << latencyAtPercentile(results.shotLatency, 50) / 1000.0 << ", p99 " << latencyAtPercentile(results.shotLatency, 99) / 1000.0 << ", max " << results.shotLatency.maxValue / 1000.0 << "\n";
+
+    if (results.numErrors > 0 || results.numLeft > 0 || results.numAborted > 0 || numFinished != expectedGames) {
+        cout << "Errors: " << results.numErrors << ", games left by an opponent: " << results.numLeft << ", games called off: " << results.numAborted << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,543 @@
+#include "header.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// ! word helpers
+
+// the helpers below work on arrays of 64-bit words. 'FIXED_WORDS' is the
+// number of words when it is known at compile time, which lets the compiler
+// fully unroll the loops for the common board sizes, or 0 to use 'numWords'.
+// on wide masks the bitwise helpers process four words at a time with AVX2
+// or two at a time with SSE2
+
+// function stores 'a & b' into 'result'
+template <int FIXED_WORDS>
+void andWords(uint64_t* result, const uint64_t* a, const uint64_t* b, int numWords) {
+    const int count = (FIXED_WORDS > 0) ? FIXED_WORDS : numWords;
+    int word = 0;
+
+#if defined(__AVX2__)
+    for (; word + 4 <= count; word += 4) {
+        __m256i left = _mm256_loadu_si256((const __m256i*)(a + word));
+        __m256i right = _mm256_loadu_si256((const __m256i*)(b + word));
+        _mm256_storeu_si256((__m256i*)(result + word), _mm256_and_si256(left, right));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; word + 2 <= count; word += 2) {
+        __m128i left = _mm_loadu_si128((const __m128i*)(a + word));
+        __m128i right = _mm_loadu_si128((const __m128i*)(b + word));
+        _mm_storeu_si128((__m128i*)(result + word), _mm_and_si128(left, right));
+    }
+#endif
+    for (; word < count; word++) {
+        result[word] = a[word] & b[word];
+    }
+}
+
+// function stores 'a | b' into 'result'
+template <int FIXED_WORDS>
+void orWords(uint64_t* result, const uint64_t* a, const uint64_t* b, int numWords) {
+    const int count = (FIXED_WORDS > 0) ? FIXED_WORDS : numWords;
+    int word = 0;
+
+#if defined(__AVX2__)
+    for (; word + 4 <= count; word += 4) {
+        __m256i left = _mm256_loadu_si256((const __m256i*)(a + word));
+        __m256i right = _mm256_loadu_si256((const __m256i*)(b + word));
+        _mm256_storeu_si256((__m256i*)(result + word), _mm256_or_si256(left, right));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; word + 2 <= count; word += 2) {
+        __m128i left = _mm_loadu_si128((const __m128i*)(a + word));
+        __m128i right = _mm_loadu_si128((const __m128i*)(b + word));
+        _mm_storeu_si128((__m128i*)(result + word), _mm_or_si128(left, right));
+    }
+#endif
+    for (; word < count; word++) {
+        result[word] = a[word] | b[word];
+    }
+}
+
+// function stores 'a & ~b' into 'result'. note that the intrinsics compute
+// '~first & second'
+template <int FIXED_WORDS>
+void andNotWords(uint64_t* result, const uint64_t* a, const uint64_t* b, int numWords) {
+    const int count = (FIXED_WORDS > 0) ? FIXED_WORDS : numWords;
+    int word = 0;
+
+#if defined(__AVX2__)
+    for (; word + 4 <= count; word += 4) {
+        __m256i left = _mm256_loadu_si256((const __m256i*)(a + word));
+        __m256i right = _mm256_loadu_si256((const __m256i*)(b + word));
+        _mm256_storeu_si256((__m256i*)(result + word), _mm256_andnot_si256(right, left));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; word + 2 <= count; word += 2) {
+        __m128i left = _mm_loadu_si128((const __m128i*)(a + word));
+        __m128i right = _mm_loadu_si128((const __m128i*)(b + word));
+        _mm_storeu_si128((__m128i*)(result + word), _mm_andnot_si128(right, left));
+    }
+#endif
+    for (; word < count; word++) {
+        result[word] = a[word] & ~b[word];
+    }
+}
+
+// function checks if every word is zero
+template <int FIXED_WORDS>
+bool isZeroWords(const uint64_t* words, int numWords) {
+    const int count = (FIXED_WORDS > 0) ? FIXED_WORDS : numWords;
+    uint64_t combined = 0;
+
+    for (int word = 0; word < count; word++) {
+        combined |= words[word];
+    }
+
+    return combined == 0;
+}
+
+// function moves every bit 'shift' positions towards bit 0, so that bit 'i'
+// of 'result' is bit 'i + shift' of 'words'
+template <int FIXED_WORDS>
+void shiftRightWords(uint64_t* result, const uint64_t* words, int shift, int numWords) {
+    const int count = (FIXED_WORDS > 0) ? FIXED_WORDS : numWords;
+    const int wordShift = shift / 64;
+    const int bitShift = shift % 64;
+
+    for (int word = 0; word < count; word++) {
+        uint64_t low = (word + wordShift < count) ? words[word + wordShift] : 0;
+        uint64_t high = (word + wordShift + 1 < count) ? words[word + wordShift + 1] : 0;
+
+        result[word] = (bitShift == 0) ? low : (low >> bitShift) | (high << (64 - bitShift));
+    }
+}
+
+// function moves every bit 'shift' positions away from bit 0, so that bit 'i'
+// of 'result' is bit 'i - shift' of 'words'. bits pushed past the end of the
+// board are left for the caller to clear
+template <int FIXED_WORDS>
+void shiftLeftWords(uint64_t* result, const uint64_t* words, int shift, int numWords) {
+    const int count = (FIXED_WORDS > 0) ? FIXED_WORDS : numWords;
+    const int wordShift = shift / 64;
+    const int bitShift = shift % 64;
+
+    for (int word = count - 1; word >= 0; word--) {
+        uint64_t high = (word - wordShift >= 0) ? words[word - wordShift] : 0;
+        uint64_t low = (word - wordShift - 1 >= 0) ? words[word - wordShift - 1] : 0;
+
+        result[word] = (bitShift == 0) ? high : (high << bitShift) | (low >> (64 - bitShift));
+    }
+}
+
+// ! masks
+
+// function works out the bit layout of a board
+BitLayout makeBitLayout(int numRows, int numCols) {
+    BitLayout layout;
+
+    layout.numRows = numRows;
+    layout.numCols = numCols;
+    layout.stride = numCols + 1;
+    layout.numWords = (numRows * layout.stride + 63) / 64;
+
+    return layout;
+}
+
+// function returns a mask with no bits set
+BitMask emptyMask(const BitLayout& layout) {
+    BitMask mask;
+
+    mask.words.assign(layout.numWords, 0);
+
+    return mask;
+}
+
+// function sets the bit of a board cell
+void setBit(const BitLayout& layout, BitMask& mask, int rowIndex, int colIndex) {
+    int index = rowIndex * layout.stride + colIndex;
+
+    mask.words[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+// function checks if the bit of a board cell is set
+bool testBit(const BitLayout& layout, const BitMask& mask, int rowIndex, int colIndex) {
+    int index = rowIndex * layout.stride + colIndex;
+
+    return (mask.words[index / 64] >> (index % 64)) & 1;
+}
+
+// function returns a mask with every cell on the board set. the guard bit
+// at the end of each row and the unused bits of the last word stay clear
+BitMask boardCellsMask(const BitLayout& layout) {
+    BitMask mask = emptyMask(layout);
+
+    for (int row = 0; row < layout.numRows; row++) {
+        for (int col = 0; col < layout.numCols; col++) {
+            setBit(layout, mask, row, col);
+        }
+    }
+
+    return mask;
+}
+
+// function returns 'a & b'
+BitMask maskAnd(const BitMask& a, const BitMask& b) {
+    BitMask result = a;
+
+    andWords<0>(result.words.data(), a.words.data(), b.words.data(), a.words.size());
+
+    return result;
+}
+
+// function returns 'a | b'
+BitMask maskOr(const BitMask& a, const BitMask& b) {
+    BitMask result = a;
+
+    orWords<0>(result.words.data(), a.words.data(), b.words.data(), a.words.size());
+
+    return result;
+}
+
+// function returns 'a & ~b'
+BitMask maskAndNot(const BitMask& a, const BitMask& b) {
+    BitMask result = a;
+
+    andNotWords<0>(result.words.data(), a.words.data(), b.words.data(), a.words.size());
+
+    return result;
+}
+
+// function checks if no bits are set
+bool isMaskEmpty(const BitMask& mask) {
+    return isZeroWords<0>(mask.words.data(), mask.words.size());
+}
+
+// function counts the bits that are set
+int countBits(const BitMask& mask) {
+    int count = 0;
+
+    for (uint64_t word : mask.words) {
+        count += __builtin_popcountll(word);
+    }
+
+    return count;
+}
+
+// function returns 'mask' with bit 'i + shift' moved to bit 'i'
+BitMask maskShiftRight(const BitMask& mask, int shift) {
+    BitMask result = mask;
+
+    shiftRightWords<0>(result.words.data(), mask.words.data(), shift, mask.words.size());
+
+    return result;
+}
+
+// function returns 'mask' with bit 'i - shift' moved to bit 'i'
+BitMask maskShiftLeft(const BitMask& mask, int shift) {
+    BitMask result = mask;
+
+    shiftLeftWords<0>(result.words.data(), mask.words.data(), shift, mask.words.size());
+
+    return result;
+}
+
+// ! placement starts
+
+// function stores in 'starts' the cells where a ship of 'shipSize' can start
+// so that every cell it covers is in 'freeCells'. a vertical ship steps a
+// whole row at a time, so the free cells are shifted by the row stride
+// instead of by one. runs that leave the board hit a guard bit or the clear
+// bits past the last row and drop out on their own. 'shifted' is scratch
+// space of the same size
+template <int FIXED_WORDS>
+void placementStartWords(const BitLayout& layout, const uint64_t* freeCells, int shipSize, char orientation, uint64_t* starts, uint64_t* shifted) {
+    const int numWords = (FIXED_WORDS > 0) ? FIXED_WORDS : layout.numWords;
+    const int step = (orientation == 'V') ? layout.stride : 1;
+
+    for (int word = 0; word < numWords; word++) {
+        starts[word] = freeCells[word];
+    }
+
+    for (int offset = 1; offset < shipSize && !isZeroWords<FIXED_WORDS>(starts, numWords); offset++) {
+        shiftRightWords<FIXED_WORDS>(shifted, freeCells, offset * step, numWords);
+        andWords<FIXED_WORDS>(starts, starts, shifted, numWords);
+    }
+}
+
+// function returns the cells where a ship of 'shipSize' can start so that
+// every cell it covers is in 'freeCells'
+BitMask placementStarts(const BitLayout& layout, const BitMask& freeCells, int shipSize, char orientation) {
+    BitMask starts = emptyMask(layout);
+    BitMask shifted = emptyMask(layout);
+
+    placementStartWords<0>(layout, freeCells.words.data(), shipSize, orientation, starts.words.data(), shifted.words.data());
+
+    return starts;
+}
+
+// ! layout sampling
+
+// function returns the bit number of set bit 'choice' of 'words', counting
+// from bit 0 and from 0
+int findSetBit(const uint64_t* words, int choice, int numWords) {
+    for (int word = 0; word < numWords; word++) {
+        const int count = __builtin_popcountll(words[word]);
+
+        if (choice < count) {
+            uint64_t bits = words[word];
+
+            for (; choice > 0; choice--) {
+                bits &= bits - 1;
+            }
+
+            return word * 64 + __builtin_ctzll(bits);
+        }
+
+        choice -= count;
+    }
+
+    return -1;
+}
+
+// function clears the cells 'placement' covers from 'freeCells', or sets
+// them again if 'isFree'
+void markPlacementCells(const BitLayout& layout, uint64_t* freeCells, const Placement& placement, bool isFree) {
+    const int step = (placement.orientation == 'V') ? layout.stride : 1;
+
+    int index = placement.rowIndex * layout.stride + placement.colIndex;
+
+    for (int offset = 0; offset < placement.shipSize; offset++, index += step) {
+        const uint64_t bit = uint64_t(1) << (index % 64);
+
+        freeCells[index / 64] = isFree ? (freeCells[index / 64] | bit) : (freeCells[index / 64] & ~bit);
+    }
+}
+
+// what is left of a fleet from each of its ships on: the sizes of the
+// largest and the smallest ship and the cells the ships cover together.
+// entry 'numShips' is a fleet with no ships, all zero
+struct FleetSuffix {
+    vector<int> largest;
+    vector<int> smallest;
+    vector<int> cells;
+};
+
+// function checks if the ships from 'shipIndex' on can still be laid out on
+// 'freeCells'. it can not if the largest of them has no placement left, or
+// if the cells some placement of the smallest of them covers are fewer than
+// the cells they need together, which catches the pockets too small for
+// any ship that leaving a ship somewhere cuts off
+template <int FIXED_WORDS>
+bool isLayoutDeadEnd(const BitLayout& layout, const uint64_t* freeCells, const FleetSuffix& suffix, int shipIndex, uint64_t* starts, uint64_t* shifted, uint64_t* usable) {
+    const char orientations[2] = {'H', 'V'};
+    const int numWords = (FIXED_WORDS > 0) ? FIXED_WORDS : layout.numWords;
+
+    if (suffix.largest[shipIndex] == 0) {
+        return false;
+    }
+
+    bool hasStart = false;
+
+    for (int side = 0; side < 2 && !hasStart; side++) {
+        placementStartWords<FIXED_WORDS>(layout, freeCells, suffix.largest[shipIndex], orientations[side], starts, shifted);
+        hasStart = !isZeroWords<FIXED_WORDS>(starts, numWords);
+    }
+
+    if (!hasStart) {
+        return true;
+    }
+
+    const int shipSize = suffix.smallest[shipIndex];
+
+    for (int word = 0; word < numWords; word++) {
+        usable[word] = 0;
+    }
+
+    for (int side = 0; side < 2; side++) {
+        const int step = (orientations[side] == 'V') ? layout.stride : 1;
+
+        placementStartWords<FIXED_WORDS>(layout, freeCells, shipSize, orientations[side], starts, shifted);
+
+        for (int offset = 0; offset < shipSize; offset++) {
+            shiftLeftWords<FIXED_WORDS>(shifted, starts, offset * step, numWords);
+            orWords<FIXED_WORDS>(usable, usable, shifted, numWords);
+        }
+    }
+
+    int numUsable = 0;
+
+    for (int word = 0; word < numWords; word++) {
+        numUsable += __builtin_popcountll(usable[word]);
+    }
+
+    return numUsable < suffix.cells[shipIndex];
+}
+
+// function draws a layout of 'fleet' into 'placements', one placement per
+// ship in fleet order. every ship is picked uniformly from the placements
+// its start masks say are still legal, so a ship costs a few mask passes
+// whatever the board and fleet are. a placement after which
+// 'isLayoutDeadEnd()' finds the ships still to come can not fit is not
+// taken, and once a ship has run out of placements the one before it is
+// taken back and redrawn. a search that keeps backing up starts over with
+// twice the budget, so it tries every layout in the end. returns false if
+// the fleet has no layout on the board, or if the search backed up more
+// than 'maxBacktracks' times in all. 0 puts no bound on it
+template <int FIXED_WORDS>
+bool fleetLayoutKernel(const BitLayout& layout, const vector<Ship>& fleet, GameRng& rng, vector<Placement>& placements, long long maxBacktracks) {
+    const char orientations[2] = {'H', 'V'};
+    const int numWords = (FIXED_WORDS > 0) ? FIXED_WORDS : layout.numWords;
+    const int numShips = fleet.size();
+
+    // the free cells and scratch masks, then the placements each ship has
+    // not tried yet, horizontal before vertical. kept between calls
+    thread_local vector<uint64_t> scratch;
+    thread_local FleetSuffix suffix;
+
+    scratch.resize((5 + 2 * numShips) * numWords);
+
+    uint64_t* freeCells = scratch.data();
+    uint64_t* shifted = freeCells + numWords;
+    uint64_t* starts = shifted + numWords;
+    uint64_t* usable = starts + numWords;
+    uint64_t* boardCells = usable + numWords;
+    uint64_t* untried = boardCells + numWords;
+
+    // the cells of a row are one run of bits, set a word at a time
+    for (int word = 0; word < numWords; word++) {
+        boardCells[word] = 0;
+    }
+
+    for (int row = 0; row < layout.numRows; row++) {
+        int index = row * layout.stride;
+
+        for (int left = layout.numCols; left > 0;) {
+            const int count = min(left, 64 - index % 64);
+            const uint64_t bits = (count == 64) ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+
+            boardCells[index / 64] |= bits << (index % 64);
+
+            index += count;
+            left -= count;
+        }
+    }
+
+    suffix.largest.assign(numShips + 1, 0);
+    suffix.smallest.assign(numShips + 1, 0);
+    suffix.cells.assign(numShips + 1, 0);
+
+    for (int shipIndex = numShips - 1; shipIndex >= 0; shipIndex--) {
+        const int shipSize = fleet[shipIndex].size;
+        const int nextSmallest = suffix.smallest[shipIndex + 1];
+
+        suffix.largest[shipIndex] = max(suffix.largest[shipIndex + 1], shipSize);
+        suffix.smallest[shipIndex] = (nextSmallest > 0) ? min(nextSmallest, shipSize) : shipSize;
+        suffix.cells[shipIndex] = suffix.cells[shipIndex + 1] + shipSize;
+    }
+
+    placements.resize(numShips);
+
+    auto findStarts = [&](int shipIndex) {
+        for (int side = 0; side < 2; side++) {
+            placementStartWords<FIXED_WORDS>(layout, freeCells, fleet[shipIndex].size, orientations[side], untried + (2 * shipIndex + side) * numWords, shifted);
+        }
+    };
+
+    long long budget = 64LL * (numShips + 1);
+    long long numBacktracks = 0;
+    long long totalBacktracks = 0;
+    int shipIndex = -1;
+
+    while (shipIndex < numShips) {
+        // (re)starts the search from an empty board
+        if (shipIndex < 0 || numBacktracks > budget) {
+            copy(boardCells, boardCells + numWords, freeCells);
+
+            if (shipIndex >= 0) {
+                budget *= 2;
+            }
+
+            numBacktracks = 0;
+            shipIndex = 0;
+
+            if (numShips == 0 || isLayoutDeadEnd<FIXED_WORDS>(layout, freeCells, suffix, 0, starts, shifted, usable)) {
+                return numShips == 0;
+            }
+
+            findStarts(0);
+        }
+
+        uint64_t* shipStarts = untried + 2 * shipIndex * numWords;
+
+        int numStarts = 0;
+
+        for (int word = 0; word < 2 * numWords; word++) {
+            numStarts += __builtin_popcountll(shipStarts[word]);
+        }
+
+        if (numStarts == 0) {
+            if (shipIndex == 0) {
+                return false;
+            }
+
+            if (maxBacktracks > 0 && ++totalBacktracks > maxBacktracks) {
+                return false;
+            }
+
+            shipIndex--;
+            numBacktracks++;
+            markPlacementCells(layout, freeCells, placements[shipIndex], true);
+            continue;
+        }
+
+        // the horizontal and vertical masks sit one after the other, so
+        // the pick is one bit of both
+        const int bit = findSetBit(shipStarts, randomBelow(rng, numStarts), 2 * numWords);
+        const int side = bit / (64 * numWords);
+        const int index = bit % (64 * numWords);
+
+        shipStarts[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+
+        Placement& placement = placements[shipIndex];
+
+        placement = {fleet[shipIndex].size, index / layout.stride, index % layout.stride, orientations[side]};
+
+        markPlacementCells(layout, freeCells, placement, false);
+
+        if (isLayoutDeadEnd<FIXED_WORDS>(layout, freeCells, suffix, shipIndex + 1, starts, shifted, usable)) {
+            markPlacementCells(layout, freeCells, placement, true);
+            continue;
+        }
+
+        shipIndex++;
+
+        if (shipIndex < numShips) {
+            findStarts(shipIndex);
+        }
+    }
+
+    return true;
+}
+
+// function draws a layout of 'fleet' with the sampling kernel. boards that
+// fit in one, two or four words (up to 8x7, 10x10 and 15x15) get a copy of
+// the kernel with the word count fixed at compile time, larger boards use
+// the generic one
+bool sampleFleetLayout(const BitLayout& layout, const vector<Ship>& fleet, GameRng& rng, vector<Placement>& placements, long long maxBacktracks) {
+    const int numWords = layout.numWords;
+
+    if (numWords <= 1) {
+        return fleetLayoutKernel<1>(layout, fleet, rng, placements, maxBacktracks);
+    } else if (numWords <= 2) {
+        return fleetLayoutKernel<2>(layout, fleet, rng, placements, maxBacktracks);
+    } else if (numWords <= 4) {
+        return fleetLayoutKernel<4>(layout, fleet, rng, placements, maxBacktracks);
+    }
+
+    return fleetLayoutKernel<0>(layout, fleet, rng, placements, maxBacktracks);
+}
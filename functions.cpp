@@ -3,7 +3,7 @@
 // ! helper functions
 
 // function selects the game mode to be played
-int chooseGameMode() {
+int chooseGameMode(InputSource& input) {
     // declares the necessary variables
     const int NUM_GAME_MODES = 3;
     const char validGameModes[NUM_GAME_MODES] = {'1', '2', '3'};
@@ -19,7 +19,7 @@ int chooseGameMode() {
     // checks if the game mode is valid
     while (!isValidGameMode) {
         cout << "Choose a game mode (1, 2, or 3): ";
-        cin >> gameMode;
+        readRequiredToken(input, gameMode);
 
         // loops through the valid game modes, and if the chosen game mode
         // is valid, we set 'isValidGameMode' to true
@@ -42,74 +42,49 @@ int chooseGameMode() {
     return stoi(gameMode);
 }
 
-// function prints the column header
-void printColumnHeader() {
-    const string spaceBetweenNumber = "   ";
+// function returns the label of a row: 'A' to 'Z', then 'AA', 'AB' and so on
+// for boards with more than 26 rows
+string rowLabel(int rowIndex) {
+    string label;
 
-    cout << "    ";
-
-    for (int colIndex = 1; colIndex <= BOARD_COL_SIZE; colIndex++) {
-        // if the 'colIndex' is 1, we dont want to print a space
-        if (colIndex == 1) {
-            cout << colIndex;
-        } else {
-            cout << spaceBetweenNumber << colIndex;
-        }
+    for (int number = rowIndex + 1; number > 0; number = (number - 1) / 26) {
+        label.insert(label.begin(), char('A' + (number - 1) % 26));
     }
-}
-
-// function displays a player's board
-void displayPlayerBoard(char board[][BOARD_COL_SIZE], int rowIndex, bool isGameStart) {
-    const char separator = '|';
-
-    // prints out the row header by using the ASCII value
-    cout << char('A' + rowIndex) << " " << separator;
 
-    // loop through the board and prints out whatever is on the board
-    // at 'rowIndex', 'colIndex'
-    for (int columnIndex = 0; columnIndex < BOARD_COL_SIZE; columnIndex++) {
-        if (!isGameStart) {
-            cout << " " << board[rowIndex][columnIndex] << " ";
-        } else {
-            char loc = board[rowIndex][columnIndex];
-
-            if (loc != 'X' && loc != 'O') {
-                loc = ' ';
-            }
-
-            cout << " " << loc << " ";
-        }
-
-        cout << separator;
-    }
+    return label;
 }
 
-// function loops through a player's fleet and calls 'placeShip' for each
-// ship, filling the board with ships
-void startShipPlacement(Player& player1, Player& player2, string player, bool isGameStart) {
-    cout << player << " set your board\n";
+// function asks the player the game is waiting for to place their whole
+// fleet, calling 'placeShip' for each ship and displaying the boards after
+// every ship
+void startShipPlacement(GameSession& session, InputSource& input, BoardRenderer& renderer) {
+    const Player& player1 = session.context->players[0];
+    const Player& player2 = session.context->players[1];
+    const int player = session.player;
+
+    cout << "Player " << player + 1 << " set your board\n";
 
     // display the initial board
-    displayBoards(player1.board, player2.board, isGameStart);
+    displayBoards(renderer, player1.board, player2.board, false);
 
-    // loops through every ship in the fleet
-    for (int shipIndex = 0; shipIndex < FLEET_SIZE; shipIndex++) {
+    // loops until the game stops waiting for this player's ships
+    while (session.stage == STAGE_PLACING && session.player == player) {
         // places the ship
-        placeShip(player == "Player 1" ? player1 : player2, shipIndex);
+        placeShip(session, input);
 
         // display the boards after ship is placed
-        displayBoards(player1.board, player2.board, isGameStart);
+        displayBoards(renderer, player1.board, player2.board, false);
     }
 }
 
 // function checks if the ship will go out of bounds, if so
 // displays the appropriate error message
-bool isShipOutOfBounds(char orientation, int shipRowIndex, int shipColIndex, int shipSize) {
+bool isShipOutOfBounds(char orientation, int shipRowIndex, int shipColIndex, int shipSize, int numRows, int numCols) {
     const char vertical = 'V';
 
     // initializes the 'startingPosition' and 'bounds' depending on the orientation
     int startingPosition = (orientation == vertical) ? shipRowIndex : shipColIndex;
-    int bounds = (orientation == vertical) ? BOARD_ROW_SIZE : BOARD_COL_SIZE;
+    int bounds = (orientation == vertical) ? numRows : numCols;
 
     // we would know if the ship is out of bounds if the place where we place the ship
     // plus the ship's size is greater than the bounds, meaning parts of the ship is
@@ -121,55 +96,70 @@ bool isShipOutOfBounds(char orientation, int shipRowIndex, int shipColIndex, int
     return false;
 }
 
-// function checks if the coordinate is valid
-bool isValidCoordinate(string coordinate, int& rowIndex, int& colIndex) {
-    const int maxCoordinateLength = 2;
+// function checks if the coordinate is valid. a coordinate is the row's
+// letters followed by the column's number, such as 'A1' or 'AB12'
+bool isValidCoordinate(const char* coordinate, size_t length, int& rowIndex, int& colIndex, int numRows, int numCols) {
+    const int maxColumnDigits = 9;
 
-    // checks if the coordinate is a string of length 2 in letter number format
-    if (coordinate.length() == maxCoordinateLength && isalpha(coordinate[0]) && isdigit(coordinate[1])) {
-        // uppercases first index
-        coordinate[0] = toupper(coordinate[0]);
+    // splits the coordinate into its letters and its digits
+    size_t numLetters = 0;
+
+    while (numLetters < length && isalpha((unsigned char)coordinate[numLetters])) {
+        numLetters++;
+    }
 
-        // convert the coordinate into int form
-        rowIndex = coordinate[0] - 'A';
-        colIndex = stoi(coordinate.substr(1)) - 1;
+    size_t numDigits = length - numLetters;
 
-        // checks if 'rowIndex' and 'colIndex' is in range of 0-6 if it is,
-        // the coordinate is valid it returns true
-        return (rowIndex >= 0 && rowIndex < BOARD_ROW_SIZE && colIndex >= 0 && colIndex < BOARD_COL_SIZE);
+    if (numLetters == 0 || numDigits == 0 || numDigits > maxColumnDigits) {
+        return false;
     }
 
-    return false;
+    // the digits are the column number. nine digits always fit in an int
+    long long col = 0;
+
+    for (size_t index = numLetters; index < length; index++) {
+        if (!isdigit((unsigned char)coordinate[index])) {
+            return false;
+        }
+
+        col = col * 10 + (coordinate[index] - '0');
+    }
+
+    // converts the letters into a row index, 'A' is 0, 'Z' is 25, 'AA' is 26
+    // and so on
+    long long row = 0;
+
+    for (size_t index = 0; index < numLetters && row <= numRows; index++) {
+        row = row * 26 + (toupper(coordinate[index]) - 'A' + 1);
+    }
+
+    rowIndex = row - 1;
+    colIndex = col - 1;
+
+    // checks if 'rowIndex' and 'colIndex' are on the board
+    return (row >= 1 && row <= numRows && colIndex >= 0 && colIndex < numCols);
+}
+
+bool isValidCoordinate(const string& coordinate, int& rowIndex, int& colIndex, int numRows, int numCols) {
+    return isValidCoordinate(coordinate.data(), coordinate.length(), rowIndex, colIndex, numRows, numCols);
 }
 
 // function checks if the current ship will intersect with any existing ships
-bool isIntersect(Player player, char orientation, int shipRowIndex, int shipColIndex, int shipSize) {
+bool isIntersect(const Player& player, char orientation, int shipRowIndex, int shipColIndex, int shipSize) {
     const char vertical = 'V';
-    const char horizontal = 'H';
 
-    // sets the starting position based on the orientation
+    // sets the starting position and the bounds based on the orientation
     const int startingPosition = (orientation == vertical) ? shipRowIndex : shipColIndex;
+    const int bounds = (orientation == vertical) ? player.board.numRows : player.board.numCols;
 
-    // loops through the indices that the ship will take up
-    for (int shipIndices = startingPosition; shipIndices < startingPosition + shipSize; shipIndices++) {
-        // loops through the player's fleet and checks if the current ship's points
-        // will intersect an existing ship's points
-        for (int shipIndex = 0; shipIndex < FLEET_SIZE; shipIndex++) {
-            Ship ship = player.fleet[shipIndex];
-
-            // checks every point in the ship
-            for (Point point : ship.points) {
-                int row = point.rowIndex;
-                int col = point.colIndex;
-
-                // depending on the orientation we check if the ship will intersect another
-                // ship. if so, we will return true
-                if (orientation == vertical && shipIndices == row && shipColIndex == col) {
-                    return true;
-                } else if (orientation == horizontal && shipIndices == col && shipRowIndex == row) {
-                    return true;
-                }
-            }
+    // loops through the cells that the ship will take up that are on the
+    // board and checks if another ship is already there
+    for (int shipIndices = startingPosition; shipIndices < min(startingPosition + shipSize, bounds); shipIndices++) {
+        int row = (orientation == vertical) ? shipIndices : shipRowIndex;
+        int col = (orientation == vertical) ? shipColIndex : shipIndices;
+
+        if (player.shipIds[row][col] != -1) {
+            return true;
         }
     }
 
@@ -177,266 +167,157 @@ bool isIntersect(Player player, char orientation, int shipRowIndex, int shipColI
 }
 
 // function removes a ship from the fleet at a specified index
-void removeShip(Ship fleet[], int& fleetSize, int shipIndex) {
+void removeShip(Player& player, int& fleetSize, int shipIndex) {
+    vector<Ship>& fleet = player.fleet;
+
+    // the removed ship's cells no longer belong to a ship in the fleet
+    for (const Point& point : fleet[shipIndex].points) {
+        player.shipIds[point.rowIndex][point.colIndex] = -1;
+    }
+
     // loop starts at 'shipIndex', the index of the ship we want to remove.
-    // we then set that index value to the value of the next index,
-    // shifting every indexed value to the left
+    // we then swap it with the next ship, shifting every ship after it to
+    // the left. swapping moves the ships without copying them, and the
+    // removed ship ends up just past the ships still afloat, ahead of the
+    // ships that sank before it. the cells of every ship that moves are
+    // pointed at its new index
     for (int i = shipIndex; i < fleetSize - 1; i++) {
-        fleet[i] = fleet[i + 1];
+        swap(fleet[i], fleet[i + 1]);
+
+        for (const Point& point : fleet[i].points) {
+            player.shipIds[point.rowIndex][point.colIndex] = i;
+        }
     }
 
     // since we removed a ship, we also need to decrease the fleet size
     fleetSize--;
 }
 
+// function checks a shot at 'coordinate' on 'player''s board without
+// reading or printing anything. the cell goes in 'shotRowIndex' and
+// 'shotColIndex'
+MoveError checkShot(const Player& player, const char* coordinate, size_t length, int& shotRowIndex, int& shotColIndex, char hitSymbol, char missSymbol) {
+    if (!isValidCoordinate(coordinate, length, shotRowIndex, shotColIndex, player.board.numRows, player.board.numCols)) {
+        return MOVE_INVALID_COORDINATE;
+    }
+
+    // a cell can only be fired at once
+    if (player.board[shotRowIndex][shotColIndex] == hitSymbol || player.board[shotRowIndex][shotColIndex] == missSymbol) {
+        return MOVE_ALREADY_FIRED;
+    }
+
+    return MOVE_OK;
+}
+
 // function handles the shot of the current player
-void handleShot(Player player, bool& shotIsValid, int& shotRowIndex, int& shotColIndex, char hitSymbol, char missSymbol) {
+void handleShot(const Player& player, bool& shotIsValid, int& shotRowIndex, int& shotColIndex, char hitSymbol, char missSymbol, InputSource& input) {
     string coordinate;
 
     // loops until 'shotIsValid' is true
     while (!shotIsValid) {
         cout << "Fire a shot: ";
-        cin >> coordinate;
-
-        // checks if the coordinate is valid with the 'isValidCoordinate()'
-        // function, if it is, we set 'shotIsValid' to true, otherwise
-        // display error message and continues
-        if (isValidCoordinate(coordinate, shotRowIndex, shotColIndex)) {
-            // checks if the coordinate has already been used and display
-            // the appropriate error message.
-            if (player.board[shotRowIndex][shotColIndex] == hitSymbol || player.board[shotRowIndex][shotColIndex] == missSymbol) {
-                cout << "Coordinate has already been used\n";
-                continue;
-            }
+        readRequiredToken(input, coordinate);
 
+        // checks the coordinate with 'checkShot()' and displays the
+        // appropriate error message if it can not be fired at
+        MoveError error = checkShot(player, coordinate.data(), coordinate.length(), shotRowIndex, shotColIndex, hitSymbol, missSymbol);
+
+        if (error == MOVE_ALREADY_FIRED) {
+            cout << "Coordinate has already been used\n";
+        } else if (error != MOVE_OK) {
+            cout << "Invalid format or coordinates out of range, try again.\n";
+        } else {
             // if the coordinate has not been used, we set 'shotIsValid' to true
             shotIsValid = true;
-        } else {
-            cout << "Invalid format or coordinates out of range, try again.\n";
         }
     }
 }
 
 // function checks if a shot is a hit or miss
-bool checkForHit(Player& player, int& fleetSize, int shotRowIndex, int shotColIndex, char hitSymbol, char missSymbol, bool isComputer, bool& hasShipSunk, vector<Ship>& sunkenShips) {
-    // we loop through every ship in the fleet and checks if the ship's
-    // points matches the location of the shot. we also need to check if
-    // the ship has sunk
-    for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
-        // assigns a referenced 'Ship' of 'currentShip' to the current
-        // indexed fleet
+bool checkForHit(Player& player, int& fleetSize, int shotRowIndex, int shotColIndex, char hitSymbol, char missSymbol, bool isComputer, bool& hasShipSunk, bool isVerbose) {
+    // looks up the ship on the shot cell. we also need to check if the ship
+    // has sunk
+    const int shipIndex = player.shipIds[shotRowIndex][shotColIndex];
+
+    if (shipIndex != -1 && shipIndex < fleetSize) {
+        // assigns a referenced 'Ship' of 'currentShip' to the ship that
+        // was hit
         Ship& currentShip = player.fleet[shipIndex];
 
-        // we loop through every point in the current ship
-        for (Point point : currentShip.points) {
-            // assigns the appropriate 'row' and 'col' values
-            int row = point.rowIndex;
-            int col = point.colIndex;
-
-            // checks if the row and column value matches. if so we
-            // print out 'Hit!' and then assign the board at the current
-            // 'shotRowIndex', 'shotColIndex' to be a 'hitSymbol'. we
-            // also increment the hit count of the current ship
-            if (row == shotRowIndex && col == shotColIndex) {
-                cout << "Hit!\n";
-
-                player.board[shotRowIndex][shotColIndex] = hitSymbol;
-
-                currentShip.hitCount++;
-
-                // if the hit count of the ship is equal to its size,
-                // we know that the ship has sunk. we display the appropriate
-                // message and remove the ship from the array with the
-                // 'removeShip()' function
+        // prints out 'Hit!' and then assigns the board at the current
+        // 'shotRowIndex', 'shotColIndex' to be a 'hitSymbol'. we also
+        // increment the hit count of the current ship
+        if (isVerbose) {
+            cout << "Hit!\n";
+        }
 
-                if (currentShip.hitCount == currentShip.size) {
-                    if (isComputer) {
-                        hasShipSunk = true;
-                        sunkenShips.push_back(currentShip);
-                    }
+        player.board[shotRowIndex][shotColIndex] = hitSymbol;
 
-                    cout << currentShip.name << " has sunken!\n";
+        currentShip.hitCount++;
 
-                    removeShip(player.fleet, fleetSize, shipIndex);
-                }
+        // if the hit count of the ship is equal to its size,
+        // we know that the ship has sunk. we display the appropriate
+        // message and remove the ship from the array with the
+        // 'removeShip()' function, which leaves it at 'fleet[fleetSize]'
+        if (currentShip.hitCount == currentShip.size) {
+            if (isComputer) {
+                hasShipSunk = true;
+            }
 
-                // we early return because we found the ship that we hit,
-                // no need to loop through the other ships
-                return true;
+            if (isVerbose) {
+                cout << currentShip.name << " has sunken!\n";
             }
+
+            removeShip(player, fleetSize, shipIndex);
         }
+
+        return true;
     }
 
     // if we did not hit, then we missed, displaying 'Miss!' and
     // then assign the board at the current 'shotRowIndex', 'shotColIndex'
     // to be a 'missSymbol'.
-    cout << "Miss!\n";
+    if (isVerbose) {
+        cout << "Miss!\n";
+    }
+
     player.board[shotRowIndex][shotColIndex] = missSymbol;
 
     return false;
 }
 
-// returns a random row/col number
-int generateRandomCoordinates() {
-    return rand() % BOARD_COL_SIZE;
-}
-
-// returns a random even row/col number
-int generateRandomEvenCoordinates() {
-    int randomEvenCoordinate;
-
-    // keeps generating a random coordinate until it is even
-    do {
-        randomEvenCoordinate = generateRandomCoordinates();
-    } while (randomEvenCoordinate % 2 != 0);
-
-    return randomEvenCoordinate;
+// returns a random row/col number below 'bound'
+int generateRandomCoordinates(int bound, GameRng& rng) {
+    return randomBelow(rng, bound);
 }
 
-// returns a random orientation
-char generateRandomOrientation() {
-    return (rand() % 2 == 0) ? 'V' : 'H';
+// returns a random even row/col number below 'bound'
+int generateRandomEvenCoordinates(int bound, GameRng& rng) {
+    // picks one of the even numbers below 'bound' directly
+    return 2 * generateRandomCoordinates((bound + 1) / 2, rng);
 }
 
-// function randomly places the ships for the computer
-void computerStartShipPlacement(Player& player1, Player& computer) {
-    // provides a seed value
-    srand((unsigned)time(NULL));
-
-    const char vertical = 'V';
-    const char horizontal = 'H';
-
-    // loops through every ship in the fleet
-    for (int shipIndex = 0; shipIndex < FLEET_SIZE; shipIndex++) {
-        Ship& ship = computer.fleet[shipIndex];
-
-        while (true) {
-            // generates a random location
-            int randRowIndex = generateRandomCoordinates();
-            int randColIndex = generateRandomCoordinates();
-
-            // generate a random orientation
-            int randOrientation = generateRandomOrientation();
-
-            // checks if the randomly generated coordinate and orientation
-            // is out of bounds or if it will intersect an existing ship,
-            // if so, we continue
-            if (isShipOutOfBounds(randOrientation, randRowIndex, randColIndex, ship.size) ||
-                isIntersect(computer, randOrientation, randRowIndex, randColIndex, ship.size)) {
-                continue;
-            }
-
-            // checks for the orientation and pushes the correct ship points
-            if (randOrientation == vertical) {
-                for (int boardRow = randRowIndex; boardRow < randRowIndex + ship.size; boardRow++) {
-                    Point shipLocation = {boardRow, randColIndex};
-
-                    ship.points.push_back(shipLocation);
-
-                    computer.board[boardRow][randColIndex] = ship.name[0];
-                }
-            } else if (randOrientation == horizontal) {
-                for (int boardCol = randColIndex; boardCol < randColIndex + ship.size; boardCol++) {
-                    Point shipLocation = {randRowIndex, boardCol};
-
-                    ship.points.push_back(shipLocation);
+// function randomly places the ships for the computer. every ship is drawn
+// from the placements still legal for it, see 'sampleFleetLayout()'.
+// returns false, leaving the fleet unplaced, if it has no layout on the
+// board, which 'checkFleetFits()' rules out before any game starts
+bool computerStartShipPlacement(Player& player1, Player& computer, GameRng& rng) {
+    // the layout is drawn into memory that is kept between games
+    thread_local vector<Placement> placements;
 
-                    computer.board[randRowIndex][boardCol] = ship.name[0];
-                }
-            }
+    const BitLayout layout = makeBitLayout(computer.board.numRows, computer.board.numCols);
 
-            break;
-        }
+    if (!sampleFleetLayout(layout, computer.fleet, rng, placements, 0)) {
+        return false;
     }
-}
-
-// function generates a random valid shot coordinate
-void randomlyGenerateShot(Player& player, int& randRowIndex, int& randColIndex, bool isTargeting, vector<Point>& potentialPoints, char hitSymbol, char missSymbol, double probabilityDensity[][BOARD_COL_SIZE], vector<Point> highestProbability) {
-    // generates a random location if the mode is not targeting,
-    // else gets a random point from the vector of 'potentialPoints'
-    if (!isTargeting) {
-        do {
-            //// generates a random even coordinate
-            // randRowIndex = generateRandomEvenCoordinates();
-            // randColIndex = generateRandomEvenCoordinates();
 
-            // picks the highest probabilty from the probablityDensity
-            vector<Point> highestProbabilityIndices;
+    for (int shipIndex = 0; shipIndex < (int)placements.size(); shipIndex++) {
+        const Placement& placement = placements[shipIndex];
 
-            double highestProbability = 0;
-
-            Point randomPoint;
-
-            for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-                for (int col = 0; col < BOARD_COL_SIZE; col++) {
-                    if (probabilityDensity[row][col] > highestProbability) {
-                        highestProbability = probabilityDensity[row][col];
-
-                        highestProbabilityIndices.clear();
-                        highestProbabilityIndices.emplace_back(Point{row, col});
-                    } else if (probabilityDensity[row][col] == highestProbability) {
-                        highestProbabilityIndices.emplace_back(Point{row, col});
-                    }
-                }
-            }
-
-            // shuffle the vector using shuffle
-            random_device rd;
-            mt19937 gen(rd());
-            shuffle(highestProbabilityIndices.begin(), highestProbabilityIndices.end(), gen);
-
-            // get a random element from the vector
-            randomPoint = highestProbabilityIndices[rand() % highestProbabilityIndices.size()];
-
-            randRowIndex = randomPoint.rowIndex;
-            randColIndex = randomPoint.colIndex;
-
-        } while (player.board[randRowIndex][randColIndex] == hitSymbol || player.board[randRowIndex][randColIndex] == missSymbol);
-    } else {
-        if (!potentialPoints.empty()) {
-            // // gets the first point in the vector of 'potentialPoints'
-            // int nextPointIndex = 0;
-
-            // // get the row index and column index
-            // randRowIndex = potentialPoints[nextPointIndex].rowIndex;
-            // randColIndex = potentialPoints[nextPointIndex].colIndex;
-            // if (!highestProbability.empty()) {
-            //     while (true) {
-            //         Point randomPoint;
-
-            //         // shuffle the vector using shuffle
-            //         random_device rd;
-            //         mt19937 gen(rd());
-            //         shuffle(highestProbability.begin(), highestProbability.end(), gen);
-
-            //         // get a random element from the vector
-            //         randomPoint = highestProbability[rand() % highestProbability.size()];
-
-            //         randRowIndex = randomPoint.rowIndex;
-            //         randColIndex = randomPoint.colIndex;
-
-            //         if (player.board[randRowIndex][randColIndex] == 'X' || player.board[randRowIndex][randColIndex] == 'O') {
-            //             continue;
-            //         } else {
-            //             break;
-            //         }
-            //     }
-            // }
-        }
-
-        Point randomPoint;
-
-        // shuffle the vector using shuffle
-        random_device rd;
-        mt19937 gen(rd());
-        shuffle(highestProbability.begin(), highestProbability.end(), gen);
-
-        // get a random element from the vector
-        randomPoint = highestProbability[rand() % highestProbability.size()];
-
-        randRowIndex = randomPoint.rowIndex;
-        randColIndex = randomPoint.colIndex;
+        placeShipAt(computer, shipIndex, placement.rowIndex, placement.colIndex, placement.orientation);
     }
+
+    return true;
 }
 
 // function checks if the shot fired is already in the vector of 'surroundingPoints'
@@ -452,7 +333,7 @@ bool isShotInPotentialPoints(int shotRowIndex, int shotColIndex, vector<Point>&
 
 // functions adds the surrounding points of where the shot was fired to a vector of
 // 'potentialPoints'
-void addSurroundingPoints(Player player, int shotRowIndex, int shotColIndex, vector<Point>& potentialPoints, char hitSymbol, char missSymbol) {
+void addSurroundingPoints(const Player& player, int shotRowIndex, int shotColIndex, vector<Point>& potentialPoints, char hitSymbol, char missSymbol) {
     // defines an array of 'Point' called directions that defines the surround four areas
     Point directions[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
 
@@ -463,7 +344,7 @@ void addSurroundingPoints(Player player, int shotRowIndex, int shotColIndex, vec
 
         // checks if the surrounding points are within range
         // if so, we add it to the vector of 'potentialPoints'
-        if (surroundingRowIndex >= 0 && surroundingRowIndex < BOARD_ROW_SIZE && surroundingColIndex >= 0 && surroundingColIndex < BOARD_COL_SIZE) {
+        if (surroundingRowIndex >= 0 && surroundingRowIndex < player.board.numRows && surroundingColIndex >= 0 && surroundingColIndex < player.board.numCols) {
             Point surroundingPoint = {surroundingRowIndex, surroundingColIndex};
 
             // checks if the surrounding point is not already marked as a hit or a miss
@@ -478,381 +359,491 @@ void addSurroundingPoints(Player player, int shotRowIndex, int shotColIndex, vec
 }
 
 // function calculates the probability density
-void calculateProbabilityDensity(Player player, int fleetSize, double probabilityDensity[][BOARD_COL_SIZE], vector<Point>& hits, bool& isTargeting, vector<Point>& highestProbabilty, bool hasShipSunk, vector<Ship> sunkenShips) {
+void calculateProbabilityDensity(const Player& player, int fleetSize, Grid<double>& probabilityDensity, vector<int>& touchedCells, vector<Point>& hits, bool& isTargeting, Point& targetShot, bool hasShipSunk, const Grid<char>& sunkCells, GameRng& rng) {
     if (fleetSize == 0) {
         return;
     }
 
-    // reset the array to zero
-    for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-        for (int col = 0; col < BOARD_COL_SIZE; col++) {
-            probabilityDensity[row][col] = 0.0;
-        }
-    }
-
-    Ship largestShip = player.fleet[0];
-
-    char orientations[2] = {'V', 'H'};
+    const int numRows = player.board.numRows;
+    const int numCols = player.board.numCols;
 
     double highestProbabilityNum = 0;
 
-    for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
-        if (player.fleet[shipIndex].size > largestShip.size) {
-            largestShip = player.fleet[shipIndex];
-        }
-    }
-
     if (hasShipSunk && hits.empty()) {
         isTargeting = false;
         // cout << "got here\n";
     }
 
-    if (!isTargeting) {
-        // cout << "and then i am here\n";
-        //  fleet
+    // in hunt mode the density counts the placements of every remaining ship
+    // that avoid all the shots fired so far. the placement index keeps it up
+    // to date after every shot, so the shot is picked straight from there
+    if (isTargeting) {
+        // cout << "or am i here\n";
+
+        // only the cells around the hits get a density, so the grid is all
+        // zero between turns and 'touchedCells' remembers which cells to
+        // look at and clear afterwards
+        touchedCells.clear();
+
+        // fleet
         for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
-            Ship currentShip = player.fleet[shipIndex];
-            // row
-            for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-                // col
-                for (int col = 0; col < BOARD_COL_SIZE; col++) {
-                    // orientation
-                    for (char orientation : orientations) {
-                        // ship length
-                        if (!isShipOutOfBounds(orientation, row, col, currentShip.size)) {
-                            // vertical
-                            if (orientation == 'V') {
-                                for (int i = 0; i < currentShip.size; i++) {
-                                    bool isAdd = true;
-
-                                    for (int j = row; j < row + currentShip.size; j++) {
-                                        if (player.board[j][col] == 'O' || player.board[j][col] == 'X') {
-                                            isAdd = false;
-                                            break;
-                                        }
-                                    }
-
-                                    for (int j = row; j < row + currentShip.size; j++) {
-                                        if (isAdd && j >= 0 && j < BOARD_ROW_SIZE) {
-                                            probabilityDensity[j][col]++;
-                                        }
-                                    }
-                                }
-                            }
+            const Ship& currentShip = player.fleet[shipIndex];
 
-                            // horizontal
-                            if (orientation == 'H') {
-                                for (int i = 0; i < currentShip.size; i++) {
-                                    bool isAdd = true;
-
-                                    for (int j = col; j < col + currentShip.size; j++) {
-                                        if (player.board[row][j] == 'O' || player.board[row][j] == 'X') {
-                                            isAdd = false;
-                                            break;
-                                        }
-                                    }
-
-                                    for (int j = col; j < col + currentShip.size; j++) {
-                                        if (isAdd && j >= 0 && j < BOARD_COL_SIZE) {
-                                            probabilityDensity[row][j]++;
-                                        }
-                                    }
-                                }
-                            }
+            // hits
+            for (Point hit : hits) {
+                int hitRow = hit.rowIndex;
+                int hitCol = hit.colIndex;
+
+                int startingRow = (hitRow + currentShip.size > numRows) ? (hitRow - ((hitRow + currentShip.size) - numRows)) : hitRow;
+                int startingCol = (hitCol + currentShip.size > numCols) ? (hitCol - ((hitCol + currentShip.size) - numCols)) : hitCol;
+
+                // a ship longer than the board in one direction can only
+                // lie the other way
+                const bool fitsVertically = currentShip.size <= numRows;
+                const bool fitsHorizontally = currentShip.size <= numCols;
+
+                int verticalBias = 0, horizontalBias = 0;
+
+                for (int i = 0; i < currentShip.size; i++) {
+                    for (int j = startingRow; fitsVertically && j < startingRow + currentShip.size; j++) {
+                        if (player.board[j][hitCol] == 'X') {
+                            verticalBias++;
+                        }
+                    }
+
+                    for (int j = startingCol; fitsHorizontally && j < startingCol + currentShip.size; j++) {
+                        if (player.board[hitRow][j] == 'X') {
+                            horizontalBias++;
                         }
                     }
                 }
-            }
-        }
-    } else if (isTargeting) {
-        // cout << "or am i here\n";
 
-        // fleet
-        for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
-            Ship currentShip = player.fleet[shipIndex];
-
-            // board
-            for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-                for (int col = 0; col < BOARD_COL_SIZE; col++) {
-                    // hits
-                    for (Point hit : hits) {
-                        int hitRow = hit.rowIndex;
-                        int hitCol = hit.colIndex;
-
-                        int startingRow = (hitRow + currentShip.size > BOARD_ROW_SIZE) ? (hitRow - ((hitRow + currentShip.size) - BOARD_ROW_SIZE)) : hitRow;
-                        int startingCol = (hitCol + currentShip.size > BOARD_COL_SIZE) ? (hitCol - ((hitCol + currentShip.size) - BOARD_COL_SIZE)) : hitCol;
-
-                        int verticalBias = 0, horizontalBias = 0;
-
-                        for (int i = 0; i < currentShip.size; i++) {
-                            for (int j = startingRow; j < startingRow + currentShip.size; j++) {
-                                if (player.board[j][hitCol] == 'X') {
-                                    verticalBias++;
-                                }
-                            }
+                // vertically
+                for (int i = 0; fitsVertically && i < currentShip.size; i++) {
+                    bool isAdd = true;
 
-                            for (int j = startingCol; j < startingCol + currentShip.size; j++) {
-                                if (player.board[hitRow][j] == 'X') {
-                                    horizontalBias++;
-                                }
-                            }
+                    for (int j = startingRow; j < startingRow + currentShip.size; j++) {
+                        if (sunkCells[j][hitCol]) {
+                            isAdd = false;
                         }
 
-                        // vertically
-                        for (int i = 0; i < currentShip.size; i++) {
-                            bool isAdd = true;
-
-                            for (int j = startingRow; j < startingRow + currentShip.size; j++) {
-                                for (Ship ship : sunkenShips) {
-                                    for (Point point : ship.points) {
-                                        int sunkenRow = point.rowIndex;
-                                        int sunkenCol = point.colIndex;
-
-                                        if (j == sunkenRow && hitCol == sunkenCol) {
-                                            isAdd = false;
-                                        }
-                                    }
-                                }
-
-                                if (player.board[j][hitCol] == 'O') {
-                                    isAdd = false;
-                                    break;
-                                }
+                        if (player.board[j][hitCol] == 'O') {
+                            isAdd = false;
+                            break;
+                        }
+                    }
+
+                    for (int j = startingRow; j < startingRow + currentShip.size; j++) {
+                        if (isAdd && j >= 0 && j < numRows) {
+                            if (probabilityDensity[j][hitCol] == 0) {
+                                touchedCells.push_back(j * numCols + hitCol);
                             }
 
-                            for (int j = startingRow; j < startingRow + currentShip.size; j++) {
-                                if (isAdd && j >= 0 && j < BOARD_ROW_SIZE) {
-                                    if (verticalBias > horizontalBias) {
-                                        probabilityDensity[j][hitCol] += 2;
-                                    } else {
-                                        probabilityDensity[j][hitCol]++;
-                                    }
-                                }
+                            if (verticalBias > horizontalBias) {
+                                probabilityDensity[j][hitCol] += 2;
+                            } else {
+                                probabilityDensity[j][hitCol]++;
                             }
+                        }
+                    }
 
-                            startingRow--;
+                    startingRow--;
 
-                            if (startingRow < 0) {
-                                break;
-                            }
+                    if (startingRow < 0) {
+                        break;
+                    }
+                }
+
+                // horizontally
+                for (int i = 0; fitsHorizontally && i < currentShip.size; i++) {
+                    bool isAdd = true;
+
+                    for (int j = startingCol; j < startingCol + currentShip.size; j++) {
+                        if (sunkCells[hitRow][j]) {
+                            isAdd = false;
                         }
 
-                        // horizontally
-                        for (int i = 0; i < currentShip.size; i++) {
-                            bool isAdd = true;
-
-                            for (int j = startingCol; j < startingCol + currentShip.size; j++) {
-                                for (Ship ship : sunkenShips) {
-                                    for (Point point : ship.points) {
-                                        int sunkenRow = point.rowIndex;
-                                        int sunkenCol = point.colIndex;
-
-                                        if (j == sunkenCol && hitRow == sunkenRow) {
-                                            isAdd = false;
-                                        }
-                                    }
-                                }
-
-                                if (player.board[hitRow][j] == 'O') {
-                                    isAdd = false;
-                                    break;
-                                }
-                            }
+                        if (player.board[hitRow][j] == 'O') {
+                            isAdd = false;
+                            break;
+                        }
+                    }
 
-                            for (int j = startingCol; j < startingCol + currentShip.size; j++) {
-                                if (isAdd && j >= 0 && j < BOARD_COL_SIZE) {
-                                    if (horizontalBias > verticalBias) {
-                                        probabilityDensity[hitRow][j] += 2;
-                                    }
-                                    probabilityDensity[hitRow][j]++;
-                                }
+                    for (int j = startingCol; j < startingCol + currentShip.size; j++) {
+                        if (isAdd && j >= 0 && j < numCols) {
+                            if (probabilityDensity[hitRow][j] == 0) {
+                                touchedCells.push_back(hitRow * numCols + j);
                             }
 
-                            startingCol--;
-
-                            if (startingCol < 0) {
-                                break;
+                            if (horizontalBias > verticalBias) {
+                                probabilityDensity[hitRow][j] += 2;
                             }
+                            probabilityDensity[hitRow][j]++;
                         }
+                    }
 
-                        for (int i = 0; i < currentShip.size; i++) {
-                            ;
-                        }
+                    startingCol--;
+
+                    if (startingCol < 0) {
+                        break;
                     }
                 }
             }
         }
-    }
 
-    highestProbabilty.clear();
-
-    for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-        for (int col = 0; col < BOARD_COL_SIZE; col++) {
-            for (Ship& sunkenShip : sunkenShips) {
-                for (Point point : sunkenShip.points) {
-                    probabilityDensity[point.rowIndex][point.colIndex] = 0;
+        // finds the touched cells with the highest density and clears the
+        // grid for the next turn. cells that have been shot are skipped,
+        // which also covers the cells of the sunken ships since every one of
+        // them is a hit. ties are broken as they come: the n-th cell found
+        // with the highest density replaces the shot with a chance of 1 in
+        // n, which leaves every tied cell equally likely to be picked
+        int numTies = 0;
+
+        for (int cell : touchedCells) {
+            int row = cell / numCols;
+            int col = cell % numCols;
+
+            if (player.board[row][col] != 'X' && player.board[row][col] != 'O') {
+                if (numTies == 0 || probabilityDensity[row][col] > highestProbabilityNum) {
+                    highestProbabilityNum = probabilityDensity[row][col];
+                    numTies = 1;
+                    targetShot = {row, col};
+                } else if (probabilityDensity[row][col] == highestProbabilityNum && randomBelow(rng, ++numTies) == 0) {
+                    targetShot = {row, col};
                 }
             }
-        }
-    }
 
-    for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-        for (int col = 0; col < BOARD_COL_SIZE; col++) {
-            if (player.board[row][col] == 'X' || player.board[row][col] == 'O') {
-                probabilityDensity[row][col] = 0;
-            }
+            probabilityDensity[row][col] = 0;
         }
-    }
 
-    for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-        for (int col = 0; col < BOARD_COL_SIZE; col++) {
-            if (probabilityDensity[row][col] > highestProbabilityNum) {
-                highestProbabilityNum = probabilityDensity[row][col];
-            }
-        }
-    }
+        touchedCells.clear();
 
-    for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-        for (int col = 0; col < BOARD_COL_SIZE; col++) {
-            if (player.board[row][col] != 'X' && player.board[row][col] != 'O' && probabilityDensity[row][col] == highestProbabilityNum) {
-                highestProbabilty.push_back({row, col});
-            }
+        // no ship fits around the hits anymore, so the computer goes back
+        // to hunting
+        if (numTies == 0) {
+            isTargeting = false;
         }
     }
 
     // // prints stuff out
-    // for (int row = 0; row < BOARD_ROW_SIZE; row++) {
-    //     for (int col = 0; col < BOARD_COL_SIZE; col++) {
+    // for (int row = 0; row < numRows; row++) {
+    //     for (int col = 0; col < numCols; col++) {
     //         cout << setw(5) << probabilityDensity[row][col] << " ";
     //     }
     //     cout << "\n";
     // }
 }
 
-// ! main functions
+// function gets a computer ready for a new game. everything is cleared
+// but keeps the memory it already has, so a computer that plays game after
+// game on the same board size stops allocating once it has warmed up
+void resetComputerState(ComputerState& computer) {
+    computer.isTargeting = false;
+    computer.hasShipSunk = false;
+    computer.touchedCells.clear();
+    computer.potentialPoints.clear();
+    computer.hits.clear();
+
+    // the placement index, the density grid and the sunk cells are set up
+    // again on the computer's first turn
+    computer.placementIndex.table = nullptr;
+}
+
+// function sets up the grids the computer fires with for a 'numRows' by
+// 'numCols' board. its placement index has to be set up already
+void prepareTargeting(ComputerState& computer, int numRows, int numCols) {
+    computer.probabilityDensity.resize(numRows, numCols, 0.0);
+    computer.sunkCells.resize(numRows, numCols, false);
 
-// function displays both players boards, side by side
-void displayBoards(char board1[][BOARD_COL_SIZE], char board2[][BOARD_COL_SIZE], bool isGameStart) {
-    const string line = "\n  -------------------------     -------------------------\n";
-    const string headerSpace = "     ";
-    const string boardSpace = "   ";
+    // none of these can hold more than one entry per cell, so with room for
+    // that many they never have to grow during a turn
+    computer.touchedCells.reserve(numRows * numCols);
+    computer.hits.reserve(numRows * numCols);
+}
 
-    // board header
-    printColumnHeader();
-    cout << headerSpace;
-    printColumnHeader();
-    cout << line;
+// function plays a single turn for a computer against 'opponent'. the computer
+// updates its probability density, picks a shot and records the result in
+// 'computer'. returns true if the shot was a hit
+bool computerTurn(Player& opponent, int& opponentNumShips, ComputerState& computer, GameRng& rng, bool isVerbose) {
+    // hit and miss symbols
+    const char hitSymbol = 'X';
+    const char missSymbol = 'O';
 
-    // creates boards
-    for (int rowIndex = 0; rowIndex < BOARD_ROW_SIZE; rowIndex++) {
-        // creates first board
-        displayPlayerBoard(board1, rowIndex, isGameStart);
+    // declares the necessary variables for the computer
+    int randRowIndex, randColIndex;
+    Point targetShot;
 
-        cout << boardSpace;
+    // builds the placement index the first time the computer fires at
+    // this fleet, unless a game context already copied one in
+    if (computer.placementIndex.table == nullptr) {
+        initPlacementIndex(computer.placementIndex, opponent.board.numRows, opponent.board.numCols, opponent.fleet, opponentNumShips);
+        prepareTargeting(computer, opponent.board.numRows, opponent.board.numCols);
+    }
 
-        // creates second board
-        displayPlayerBoard(board2, rowIndex, isGameStart);
+    COUNT_TURN_EVENT(COUNTER_COMPUTER_TURNS);
 
-        cout << line;
+    bool isSolved = false;
+    bool isSampled = false;
+
+    {
+        TIME_PHASE(PHASE_DENSITY);
+
+        // once few enough layouts of the remaining ships are left, the exact
+        // solver picks the shot in either mode
+        isSolved = solveEndgameShot(opponent, opponentNumShips, computer, targetShot, rng);
+
+        // calculates the probability density before generating a shot. the
+        // Monte Carlo engine takes over the targeting while there are hits
+        // on ships that have not sunk, and the heuristic steps in if it can
+        // not sample any fleet
+        isSampled = !isSolved && computer.engine == MONTE_CARLO_TARGETING && computer.isTargeting && !computer.hits.empty() &&
+                    sampleTargetShot(opponent, opponentNumShips, computer, targetShot, rng);
+
+        if (!isSolved && !isSampled) {
+            calculateProbabilityDensity(opponent, opponentNumShips, computer.probabilityDensity, computer.touchedCells, computer.hits, computer.isTargeting, targetShot, computer.hasShipSunk, computer.sunkCells, rng);
+        }
     }
-}
 
-// An initFleet function that takes in a Player object
-// as a parameter and initializes the board and all the ships
-// in the fleet with the appropriate information. For example,
-// the name and size of the ship should be initialized within
-// the function.
-void initFleet(Player& player) {
-    // initialize the board with empty spaces
-    for (int rowIndex = 0; rowIndex < BOARD_ROW_SIZE; rowIndex++) {
-        for (int columnIndex = 0; columnIndex < BOARD_COL_SIZE; columnIndex++) {
-            player.board[rowIndex][columnIndex] = ' ';
+    if (isSolved) {
+        COUNT_TURN_EVENT(COUNTER_EXACT_SOLVES);
+    } else if (isSampled) {
+        COUNT_TURN_EVENT(COUNTER_MONTE_CARLO_SHOTS);
+    }
+
+    {
+        TIME_PHASE(PHASE_SHOT_SELECTION);
+
+        // randomly generates a shot by the computer depending on the mode.
+        // in target mode the density has already picked one of the cells
+        // around the hits, in hunt mode the shot is one of the cells with
+        // the highest density
+        if (isSolved || computer.isTargeting) {
+            randRowIndex = targetShot.rowIndex;
+            randColIndex = targetShot.colIndex;
+        } else {
+            pickHighestDensityCell(computer.placementIndex, randRowIndex, randColIndex, rng);
         }
     }
 
-    // initializes neccessary variables to read in data from 'ships.txt'
-    ifstream inStream;
+    // the rest of the turn fires the shot and records what it hit, in the
+    // board and in the computer's placement index
+    TIME_PHASE(PHASE_HIT_RESOLUTION);
+
+    computer.hasShipSunk = false;
+
+    // defines the point the computer shot at
+    Point point = {randRowIndex, randColIndex};
+
+    computer.lastShot = point;
+
+    // no placement that covers the shot is possible anymore
+    recordShot(computer.placementIndex, randRowIndex, randColIndex);
+
+    if (isVerbose) {
+        cout << "Computer shot at (" << rowLabel(randRowIndex) << ", " << randColIndex + 1 << ") \n";
+    }
+
+    // checks if the shot generated is a hit or not, if it is, we do something with it
+    // if it is not, we check if there are any potential points and continue targeting
+    if (checkForHit(opponent, opponentNumShips, randRowIndex, randColIndex, hitSymbol, missSymbol, true, computer.hasShipSunk, isVerbose)) {
+        COUNT_TURN_EVENT(COUNTER_HITS);
+
+        computer.isTargeting = true;
+
+        computer.hits.push_back(point);
+
+        if (computer.hasShipSunk) {
+            // the ship that just sunk sits right after the ships still
+            // afloat. dont clear all points but just remove the points of
+            // that ship, and remember where it was
+            const Ship& sunkenShip = opponent.fleet[opponentNumShips];
+
+            for (const Point& sunkenPoint : sunkenShip.points) {
+                computer.hits.erase(remove(computer.hits.begin(), computer.hits.end(), sunkenPoint), computer.hits.end());
+                computer.sunkCells[sunkenPoint.rowIndex][sunkenPoint.colIndex] = true;
+            }
+
+            // the remaining ships of that size now count for one less
+            recordSunkShip(computer.placementIndex, sunkenShip.size);
+        }
+
+        return true;
+    }
+
+    // remove this point from the vector of potential points
+    computer.potentialPoints.erase(remove(computer.potentialPoints.begin(), computer.potentialPoints.end(), point), computer.potentialPoints.end());
+
+    return false;
+}
+
+// ! main functions
+
+// function reads the fleet in 'shipsFile' into 'fleet'. every line is a
+// comment starting with '#', blank, or a ship written as its number, its
+// name and its size. returns false with the problem in 'error' if the file
+// can not be read or a line is not like that
+bool loadFleetTemplate(FleetTemplate& fleet, const string& shipsFile, string& error) {
+    ifstream inStream(shipsFile);
     string line;
-    int shipIndex = 0;
+    int lineNumber = 0;
 
-    inStream.open("ships.txt");
+    fleet.shipsFile = shipsFile;
+    fleet.ships.clear();
 
-    // exit in the case that we can't open the file
     if (inStream.fail()) {
-        cout << "Error opening file!";
-        exit(1);
+        error = "Error opening " + shipsFile;
+        return false;
     }
 
-    // loop through every line in 'ships.txt'
+    // loop through every line in the ships file
     while (getline(inStream, line)) {
-        // if the line starts with a #, we skip it
-        if (line[0] == '#') {
-            continue;
-        }
+        lineNumber++;
 
         istringstream lineStream(line);
 
+        // blank lines and lines starting with a # are skipped
+        if (!(lineStream >> ws) || lineStream.peek() == EOF || lineStream.peek() == '#') {
+            continue;
+        }
+
         string shipName;
         int shipSize;
-        int hitCount = 0;
-        vector<Point> points = {};
-
         int num;
 
-        // splits up every line into three variables
-        lineStream >> num >> shipName >> shipSize;
+        // splits up every line into three fields, with nothing after them
+        if (!(lineStream >> num >> shipName >> shipSize) || !(lineStream >> ws).eof()) {
+            error = shipsFile + " line " + to_string(lineNumber) + ": expected a number, a name and a size";
+            return false;
+        }
+
+        if (shipSize < 1) {
+            error = shipsFile + " line " + to_string(lineNumber) + ": the " + shipName + " needs a size of at least 1";
+            return false;
+        }
+
+        // the first letter of the name marks the ship on the board, so it
+        // can not look like a hit or a miss
+        if (shipName[0] == 'X' || shipName[0] == 'O') {
+            error = shipsFile + " line " + to_string(lineNumber) + ": a ship name can not start with X or O";
+            return false;
+        }
 
-        // creates a Ship called 'ship' with the collected data
         Ship ship = {
             shipName,
             shipSize,
-            hitCount,
-            points,
+            0,
+            {},
+            (int)fleet.ships.size(),
         };
 
-        // assigns the ship to the player's fleet at 'shipIndex' index
-        player.fleet[shipIndex] = ship;
+        fleet.ships.push_back(ship);
+    }
+
+    return true;
+}
+
+// function checks that the fleet in 'fleet' can be laid out on a 'numRows'
+// by 'numCols' board, which the computers need to place it. the search for
+// a layout is bounded, since ruling one out can take very long. returns
+// false with the problem in 'error' if every ship does not fit on its own,
+// the fleet needs more cells than the board has, or no layout was found
+bool checkFleetFits(const FleetTemplate& fleet, int numRows, int numCols, string& error) {
+    const long long maxLayoutBacktracks = 1 << 18;
+
+    const string boardName = to_string(numRows) + "x" + to_string(numCols) + " board";
+
+    // every ship has to fit on the board in at least one direction, and the
+    // fleet can not take up more cells than the board has
+    long long fleetCells = 0;
+
+    for (const Ship& ship : fleet.ships) {
+        if (ship.size > max(numRows, numCols)) {
+            error = "The " + ship.name + " does not fit on a " + boardName + ".";
+            return false;
+        }
+
+        fleetCells += ship.size;
+    }
+
+    if (fleet.ships.empty() || fleetCells > (long long)numRows * numCols) {
+        error = "The fleet in " + fleet.shipsFile + " does not fit on a " + boardName + ".";
+        return false;
+    }
+
+    vector<Placement> layout;
+    GameRng rng = makeGameRng(0, 0);
+
+    if (!sampleFleetLayout(makeBitLayout(numRows, numCols), fleet.ships, rng, layout, maxLayoutBacktracks)) {
+        error = "No layout of the fleet in " + fleet.shipsFile + " without overlapping ships was found on a " + boardName + " within the search limit, it may not have one.";
+        return false;
+    }
+
+    return true;
+}
+
+// An initFleet function that takes in a Player object
+// as a parameter and initializes the board and all the ships
+// in the fleet with the appropriate information. For example,
+// the name and size of the ship should be initialized within
+// the function. the fleet is copied from the config's fleet
+// template, the ships file is only read if there is none
+void initFleet(Player& player, const GameConfig& config) {
+    // initialize the board with empty spaces
+    player.board.resize(config.numRows, config.numCols, ' ');
+    player.shipIds.resize(config.numRows, config.numCols, -1);
+
+    if (config.fleetTemplate != nullptr) {
+        // the ships keep their buffers, so copying over the fleet of the
+        // last game does not allocate
+        player.fleet = config.fleetTemplate->ships;
+        return;
+    }
+
+    FleetTemplate fleet;
+    string error;
 
-        // moves to next ship
-        shipIndex++;
+    // exit in the case that we can't read the file
+    if (!loadFleetTemplate(fleet, config.shipsFile, error)) {
+        cout << error << "\n";
+        exit(1);
     }
 
-    inStream.close();
+    player.fleet = fleet.ships;
 }
 
-// A boardSetup function that takes in two Player objects
-// by reference, and calls the placeShip function for each ship
-// in the fleet.  After each ship is placed on the board the
-// boards should be displayed.
-void boardSetup(Player& player1, Player& player2, int gameMode, bool isGameStart) {
+// A boardSetup function that takes in the game and calls the
+// placeShip function for each ship of the players who place
+// their own fleets. After each ship is placed on the board the
+// boards should be displayed. the computers placed theirs when
+// the game started
+void boardSetup(GameSession& session, InputSource& input, BoardRenderer& renderer) {
     // checks the game mode first, 1 for pvp, 2 for p vs. computer
-    if (gameMode == 1) {
+    if (session.gameMode == 1) {
         // asks 'Player 1' for their ship placement
-        startShipPlacement(player1, player2, "Player 1", isGameStart);
+        startShipPlacement(session, input, renderer);
 
         cout << "\n";
 
         // asks 'Player 2' for their ship placement
-        startShipPlacement(player1, player2, "Player 2", isGameStart);
-    } else if (gameMode == 2) {
+        startShipPlacement(session, input, renderer);
+    } else if (session.gameMode == 2) {
         // asks 'Player 1' for their ship placement
-        startShipPlacement(player1, player2, "Player 1", isGameStart);
+        startShipPlacement(session, input, renderer);
 
         cout << "\n";
 
         cout << "The computer will now randomly place their ships\n";
-
-        computerStartShipPlacement(player1, player2);
-
-        // displayBoards(player1.board, player2.board, isGameStart);
-    } else if (gameMode == 3) {
+        playComputerMove(session);
+    } else if (session.gameMode == 3) {
         cout << "Computer 1 will now randomly place their ships\n";
 
-        computerStartShipPlacement(player2, player1);
+        // the game is over without a winner if the fleet has no layout
+        if (!playComputerMove(session)) {
+            return;
+        }
 
         cout << "Computer 2 will now randomly place their ships\n";
-
-        computerStartShipPlacement(player1, player2);
+        playComputerMove(session);
     }
 }
 
@@ -874,7 +865,7 @@ void boardSetup(Player& player1, Player& player2, int gameMode, bool isGameStart
 // is received from the user.  The function will also call the
 // function spaceOccupied to determine if any of the spaces the
 // ship would take up if placed on the board are currently occupied.
-void getValidShipInfo(Player& player, int& rowIndex, int& colIndex, char& orientation, int shipIndex) {
+void getValidShipInfo(Player& player, int& rowIndex, int& colIndex, char& orientation, int shipIndex, InputSource& input) {
     const string shipName = player.fleet[shipIndex].name;
     const int shipSize = player.fleet[shipIndex].size;
 
@@ -882,15 +873,15 @@ void getValidShipInfo(Player& player, int& rowIndex, int& colIndex, char& orient
     const char horizontal = 'H';
 
     // loops to confirm the ship placement is valid
-    while (true) {
-        string coordinate;
+    string coordinate, orientationToken;
 
+    while (true) {
         // gets the coordinates
         cout << "Enter the starting coordinates of your " << shipName << " (size: " << shipSize << "): ";
-        cin >> coordinate;
+        readRequiredToken(input, coordinate);
 
         // checks if the coordinate is in letter number format, if not, we continue
-        if (!isValidCoordinate(coordinate, rowIndex, colIndex)) {
+        if (!isValidCoordinate(coordinate, rowIndex, colIndex, player.board.numRows, player.board.numCols)) {
             cout << "Invalid format or coordinates out of range, try again.\n";
             continue;
         }
@@ -898,10 +889,10 @@ void getValidShipInfo(Player& player, int& rowIndex, int& colIndex, char& orient
         // confirms the validity of 'orientation'
         while (true) {
             cout << "Enter the orientation of your " << shipName << " (horizontal(h) or vertical(v)): ";
-            cin >> orientation;
+            readRequiredToken(input, orientationToken);
 
-            // uppercases 'orientation'
-            orientation = toupper(orientation);
+            // uppercases 'orientation'. only one letter is an orientation
+            orientation = (orientationToken.length() == 1) ? toupper(orientationToken[0]) : ' ';
 
             // checks if 'orientation' is either 'V' or 'H'
             if (orientation == vertical || orientation == horizontal) {
@@ -919,23 +910,30 @@ void getValidShipInfo(Player& player, int& rowIndex, int& colIndex, char& orient
     }
 }
 
-// A placeShip function that takes in a Player object by
-// reference and an int variable that stores the index of the
-// ship that is currently being placed, and places the ship onto
-// the board. The placeShip function calls the getValidShipInfo
-// function to determine which spots on the board the ship will
-// occupy.
-void placeShip(Player& player, int shipIndex) {
+// A placeShip function that takes in the game and places the
+// next ship of the player it is waiting for onto the board.
+// The placeShip function calls the getValidShipInfo function
+// to determine which spots on the board the ship will occupy.
+void placeShip(GameSession& session, InputSource& input) {
     // initializes the necessary variables to place the ship
     int rowIndex = 0, colIndex = 0;
     char orientation = ' ';
 
-    const char vertical = 'V';
-    const char horizontal = 'H';
+    Player& player = session.context->players[session.player];
 
     // checks if the ship is valid and if we can place it with 'getValidShipInfo()'
     // also updates 'rowIndex', 'colIndex' and 'orientation' through reference
-    getValidShipInfo(player, rowIndex, colIndex, orientation, shipIndex);
+    getValidShipInfo(player, rowIndex, colIndex, orientation, session.shipsPlaced[session.player], input);
+
+    placeSessionShip(session, session.player, rowIndex, colIndex, orientation);
+}
+
+// function puts ship 'shipIndex' of 'player' on the board at 'rowIndex',
+// 'colIndex' along 'orientation'. the placement has to be checked with
+// 'checkShipPlacement()' first
+void placeShipAt(Player& player, int shipIndex, int rowIndex, int colIndex, char orientation) {
+    const char vertical = 'V';
+    const char horizontal = 'H';
 
     // creates a new Ship called 'ship' that references the ship in the
     // players board. this makes it easier when we need to access the
@@ -954,6 +952,7 @@ void placeShip(Player& player, int shipIndex) {
             // gets the first character in the ship name and assigns it to
             // the board
             player.board[boardRow][colIndex] = ship.name[0];
+            player.shipIds[boardRow][colIndex] = shipIndex;
         }
     } else if (orientation == horizontal) {
         for (int boardCol = colIndex; boardCol < colIndex + ship.size; boardCol++) {
@@ -964,6 +963,7 @@ void placeShip(Player& player, int shipIndex) {
             // gets the first character in the ship name and assigns it to
             // the board
             player.board[rowIndex][boardCol] = ship.name[0];
+            player.shipIds[rowIndex][boardCol] = shipIndex;
         }
     }
 }
@@ -973,188 +973,172 @@ void placeShip(Player& player, int shipIndex) {
 // for the orientation, and the ship size. This function returns
 // true if the placement of the ship would overlap an already
 // existing ship placement or false if the space is not occupied.
-bool spaceOccupied(Player player, int shipRowIndex, int shipColIndex, char orientation, int shipSize) {
+bool spaceOccupied(const Player& player, int shipRowIndex, int shipColIndex, char orientation, int shipSize) {
+    MoveError error = checkShipPlacement(player, shipRowIndex, shipColIndex, orientation, shipSize);
+
+    if (error == MOVE_OUT_OF_BOUNDS) {
+        cout << "Error: Ship placement is outside the board.\n";
+        return true;
+    }
+
+    if (error == MOVE_SPACE_OCCUPIED) {
+        cout << "Error: Space already occupied.\n";
+        return true;
+    }
+
+    return false;
+}
+
+// function checks if a ship of 'shipSize' can be placed on 'player''s board
+// at 'shipRowIndex', 'shipColIndex' along 'orientation', without printing
+// anything
+MoveError checkShipPlacement(const Player& player, int shipRowIndex, int shipColIndex, char orientation, int shipSize) {
     const char vertical = 'V';
     const char horizontal = 'H';
 
+    if (orientation != vertical && orientation != horizontal) {
+        return MOVE_INVALID_ORIENTATION;
+    }
+
     // checks the orientation of the ship and loop accordingly,
     // if it is vertical, we only need to loop through the rows,
     // likewise, if it is horizontal, we only need to loop through
-    // the columns
-    if (orientation == vertical || orientation == horizontal) {
-        // checks if the ship will go out of bounds
-        if (isShipOutOfBounds(orientation, shipRowIndex, shipColIndex, shipSize)) {
-            cout << "Error: Ship placement is outside the board.\n";
-            return true;
-        }
+    // the columns. checks if the ship will go out of bounds
+    if (isShipOutOfBounds(orientation, shipRowIndex, shipColIndex, shipSize, player.board.numRows, player.board.numCols)) {
+        return MOVE_OUT_OF_BOUNDS;
+    }
 
-        // checks if ship will intersect another ship
-        if (isIntersect(player, orientation, shipRowIndex, shipColIndex, shipSize)) {
-            cout << "Error: Space already occupied.\n";
-            return true;
-        }
+    // checks if ship will intersect another ship
+    if (isIntersect(player, orientation, shipRowIndex, shipColIndex, shipSize)) {
+        return MOVE_SPACE_OCCUPIED;
     }
 
-    return false;
+    return MOVE_OK;
 }
 
-// function starts the game, and declares a winner when the
-// opponent's fleet is destroyed
-void play(Player& player1, Player& player2, int gameMode) {
-    // declare the number of ships in each player's fleet
-    int player1NumShips = FLEET_SIZE;
-    int player2NumShips = FLEET_SIZE;
-
-    // tracks if the game has started
-    bool isGameStart = false;
-
-    // hit and miss symbols
-    const char hitSymbol = 'X';
-    const char missSymbol = 'O';
+// function prints how the last shot of 'session' turned out, the way
+// 'checkForHit()' does when it is verbose
+void printShotResult(const GameSession& session) {
+    const RecordedShot& shot = session.lastShot;
 
-    // tracks whose turn it is
-    bool playerOneTurn = true;
+    if (shot.result == SHOT_MISS) {
+        cout << "Miss!\n";
+        return;
+    }
 
-    // defines the computer's mode
-    // if it is not targeting it is firing at random, else
-    // it searches the location around the successful shot
-    bool isTargeting = false;
+    cout << "Hit!\n";
 
-    // vector of potential points for the computer to hit
-    vector<Point> potentialPoints;
+    // the ship that just sunk sits right after the ships still afloat
+    if (shot.result == SHOT_SINK) {
+        const int target = 1 - shot.shooter;
 
-    // defines the probability density
-    double probabilityDensity[BOARD_ROW_SIZE][BOARD_COL_SIZE] = {};
+        cout << session.context->players[target].fleet[session.context->numShips[target]].name << " has sunken!\n";
+    }
+}
 
-    // defines a vector of hits
-    vector<Point> hits;
+// function starts the game, and declares a winner when the
+// opponent's fleet is destroyed. the game is played in 'context' as a
+// 'GameSession', this is only where its moves come from and what is shown
+// of them: the players' answers are read from 'input' and the boards are
+// drawn with 'renderer'. if 'recorder' is not null the placements and every
+// shot are recorded into it. returns false if a computer could not lay out
+// its fleet on the board, which ends the game without a winner
+bool play(GameContext& context, int gameMode, const GameConfig& config, GameRng& rng, GameRecorder* recorder, InputSource& input, BoardRenderer& renderer) {
+    // hit and miss symbols
+    const char hitSymbol = 'X';
+    const char missSymbol = 'O';
 
-    // defines a vector of highestProbablity
-    vector<Point> highestProbabilty;
+    // sets up empty boards with the whole fleets, and the computers'
+    // targeting state. a computer places its fleet when its turn to place comes
+    GameSession session;
 
-    // defines a vector of sunken ships
-    vector<Ship> sunkenShips;
+    if (recorder != nullptr) {
+        recorder->gameMode = gameMode;
+    }
 
-    // tracks of a ship has sunk
-    bool hasShipSunk = false;
+    startGameSession(session, context, gameMode, config, rng, recorder);
 
-    // initializes the fleet's of player 1 and player 2
-    initFleet(player1);
-    initFleet(player2);
+    const Player& player1 = context.players[0];
+    const Player& player2 = context.players[1];
 
     // sets up the board by asking the user for ship positions
-    boardSetup(player1, player2, gameMode, isGameStart);
+    boardSetup(session, input, renderer);
 
     // game keeps running until either player's fleet is destroyed
-    while (player1NumShips > 0 && player2NumShips > 0) {
-        // declares the necessary variables
-        string coordinate;
-        int shotRowIndex, shotColIndex;
-        bool shotIsValid = false;
-
-        isGameStart = true;
-
-        cout << "Player " << (playerOneTurn ? 1 : 2) << ":\n";
-
-        if (gameMode == 1) {
-            // calls 'handleShot(); to handle the shot of the current user
-            handleShot((playerOneTurn ? player2 : player1), shotIsValid, shotRowIndex, shotColIndex, hitSymbol, missSymbol);
+    while (session.stage != STAGE_OVER) {
+        const int shooter = session.player;
 
-            // calls 'checkForHit()' to see if it was a hit or miss
-            checkForHit((playerOneTurn ? player2 : player1), (playerOneTurn ? player2NumShips : player1NumShips), shotRowIndex, shotColIndex, hitSymbol, missSymbol, false, hasShipSunk, sunkenShips);
+        if (gameMode != 2 || shooter == 0) {
+            // prints the turn stats between turns if they were asked for
+            POLL_TURN_STATS();
 
-            playerOneTurn = !playerOneTurn;
-        } else if (gameMode == 2) {
-            // declares the necessary variables for the computer
-            int randRowIndex, randColIndex;
-
-            // handles the shots and hits of the user
-            handleShot(player2, shotIsValid, shotRowIndex, shotColIndex, hitSymbol, missSymbol);
-            checkForHit(player2, player2NumShips, shotRowIndex, shotColIndex, hitSymbol, missSymbol, false, hasShipSunk, sunkenShips);
-
-            displayBoards(player1.board, player2.board, isGameStart);
+            if (gameMode == 3) {
+                cout << "Computer " << shooter + 1 << ":\n";
+            } else {
+                cout << "Player " << shooter + 1 << ":\n";
+            }
+        } else {
+            // in game mode 2 the computer fires back within the player's
+            // turn, once the boards show the player's shot
+            displayBoards(renderer, player1.board, player2.board, true);
 
             cout << "Computer: \n";
+        }
 
-            // calculates the probability density before generating a shot
-            calculateProbabilityDensity(player1, player1NumShips, probabilityDensity, hits, isTargeting, highestProbabilty, hasShipSunk, sunkenShips);
-
-            // randomly generates a shot by the computer depending on the mode
-            randomlyGenerateShot(player1, randRowIndex, randColIndex, isTargeting, potentialPoints, hitSymbol, missSymbol, probabilityDensity, highestProbabilty);
-
-            hasShipSunk = false;
-
-            // defines the point the computer shot at
-            Point point = {randRowIndex, randColIndex};
-
-            cout << "Computer shot at (" << char('A' + randRowIndex) << ", " << randColIndex + 1 << ") \n";
-
-            // checks if the shot generated is a hit or not, if it is, we do something with it
-            // if it is not, we check if there are any potential points and continue targeting
-            if (checkForHit(player1, player1NumShips, randRowIndex, randColIndex, hitSymbol, missSymbol, true, hasShipSunk, sunkenShips)) {
-                isTargeting = true;
-
-                hits.push_back({randRowIndex, randColIndex});
+        if (isComputerToMove(session)) {
+            playComputerMove(session);
 
-                if (hasShipSunk) {
-                    // dont clear all points but just remove the points of the ship that just sunk
-                    Ship sunkenShip = sunkenShips.back();
+            cout << "Computer shot at (" << rowLabel(session.lastShot.rowIndex) << ", " << session.lastShot.colIndex + 1 << ") \n";
+            printShotResult(session);
+            cout << "\n";
+        } else {
+            int shotRowIndex, shotColIndex;
+            bool shotIsValid = false;
 
-                    for (Point& point : sunkenShip.points) {
-                        hits.erase(remove(hits.begin(), hits.end(), point), hits.end());
-                    }
-                }
+            // calls 'handleShot()' to handle the shot of the current user
+            handleShot(context.players[1 - shooter], shotIsValid, shotRowIndex, shotColIndex, hitSymbol, missSymbol, input);
 
-                // // checks if the shot is in the vector of 'potentialPoints'
-                // // if it is we remove it from the vector
-                // if (isShotInPotentialPoints(randRowIndex, randColIndex, potentialPoints)) {
-                //     potentialPoints.erase(remove(potentialPoints.begin(), potentialPoints.end(), point), potentialPoints.end());
-                // }
+            fireSessionShot(session, shotRowIndex, shotColIndex);
+            printShotResult(session);
 
-                // // adds the surrounding points of the shot fire
-                // addSurroundingPoints(player1, randRowIndex, randColIndex, potentialPoints, hitSymbol, missSymbol);
-            } else {
-                // remove this point from the vector of potential points
-                potentialPoints.erase(remove(potentialPoints.begin(), potentialPoints.end(), point), potentialPoints.end());
-
-                // if there are no potential points we switch to hunting mode,
-                // else we continue with targeting mode
-                // if (potentialPoints.empty()) {
-                //     isTargeting = false;
-                // } else {
-                //     isTargeting = true;
-                // }
+            // the computer's answer comes before the boards are printed
+            if (gameMode == 2 && session.stage != STAGE_OVER) {
+                continue;
             }
-
-            cout << "\n";
         }
 
-        // breaks the loop
-        if (player1NumShips == 0 || player2NumShips == 0) {
-            isGameStart = false;
-
-            // prints the ended board
-            displayBoards(player1.board, player2.board, isGameStart);
+        // prints the current board, or the ended board with the ships
+        // showing
+        displayBoards(renderer, player1.board, player2.board, session.stage != STAGE_OVER);
+    }
 
-            break;
-        } else {
-            // prints the current board
-            displayBoards(player1.board, player2.board, isGameStart);
-        }
+    if (session.winner < 0) {
+        cout << "The computer could not lay out its fleet on the board, the game can not be played.\n";
+        DUMP_TURN_STATS();
+        return false;
     }
 
     // declares the winner
     if (gameMode == 1) {
-        if (player1NumShips > player2NumShips) {
+        if (session.winner == 0) {
             cout << "Player 1 sunk the fleet! Player 1 wins!\n";
         } else {
             cout << "Player 2 sunk the fleet! Player 2 wins!\n";
         }
     } else if (gameMode == 2) {
-        if (player1NumShips > player2NumShips) {
+        if (session.winner == 0) {
             cout << "Player 1 sunk the fleet! Player 1 wins!\n";
         } else {
             cout << "The computer sunk the fleet! The computer wins!\n";
         }
+    } else if (gameMode == 3) {
+        if (session.winner == 0) {
+            cout << "Computer 1 sunk the fleet! Computer 1 wins!\n";
+        } else {
+            cout << "Computer 2 sunk the fleet! Computer 2 wins!\n";
+        }
     }
-}
\ No newline at end of file
+
+    DUMP_TURN_STATS();
+    return true;
+}
@@ -1,23 +1,195 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <csignal>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace std;
 
 // constants
-const int BOARD_ROW_SIZE = 6;
-const int BOARD_COL_SIZE = 6;
-const int FLEET_SIZE = 5;
+const int DEFAULT_BOARD_ROW_SIZE = 6;
+const int DEFAULT_BOARD_COL_SIZE = 6;
+
+// random numbers
+
+// the xoshiro256** generator by Blackman and Vigna. it is much smaller and
+// faster than mt19937 and works as a standard uniform random bit generator,
+// so the standard distributions accept it too. the four words of state are
+// filled from the seed with splitmix64
+struct Xoshiro256 {
+    typedef uint64_t result_type;
+
+    uint64_t state[4];
+
+    explicit Xoshiro256(uint64_t seed = 0) {
+        for (uint64_t& word : state) {
+            seed += 0x9E3779B97F4A7C15;
+
+            uint64_t mixed = seed;
+            mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EB;
+            word = mixed ^ (mixed >> 31);
+        }
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return UINT64_MAX;
+    }
+
+    result_type operator()() {
+        const uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+        const uint64_t shifted = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotateLeft(state[3], 45);
+
+        return result;
+    }
+
+    static uint64_t rotateLeft(uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+};
+
+// the engine every game, computer and simulation draws from. another engine
+// with 64-bit output can be plugged in here
+typedef Xoshiro256 GameRng;
+
+// function returns a random number from 0 up to 'bound' - 1, every value
+// equally likely. the top 32 bits are scaled into the range with a multiply
+// (Lemire's method), and the few draws that would make some values more
+// likely than others are rejected. there is no division in the common case
+inline uint32_t randomBelow(GameRng& rng, uint32_t bound) {
+    uint64_t product = (rng() >> 32) * bound;
+    uint32_t low = uint32_t(product);
+
+    if (low < bound) {
+        const uint32_t threshold = uint32_t(-bound) % bound;
+
+        while (low < threshold) {
+            product = (rng() >> 32) * bound;
+            low = uint32_t(product);
+        }
+    }
+
+    return product >> 32;
+}
+
+// instrumentation
+
+// the parts of a turn that are timed. only a build with
+// BATTLESHIP_INSTRUMENT defined times anything, every other build compiles
+// the timers and counters below out completely
+enum TurnPhase {
+    PHASE_DENSITY,
+    PHASE_SHOT_SELECTION,
+    PHASE_HIT_RESOLUTION,
+    PHASE_RENDERING,
+    NUM_TURN_PHASES,
+};
+
+// the events that are counted
+enum TurnCounter {
+    COUNTER_COMPUTER_TURNS,
+    COUNTER_HITS,
+    COUNTER_EXACT_SOLVES,
+    COUNTER_MONTE_CARLO_SHOTS,
+    NUM_TURN_COUNTERS,
+};
+
+// a histogram of latencies in nanoseconds in the style of HdrHistogram.
+// every power of two is split into 'SUB_BUCKETS' equal buckets, so any
+// latency is recorded to within about 3% however long it is, and recording
+// one is a couple of shifts and an increment
+struct LatencyHistogram {
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int NUM_BUCKETS = SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1);
+
+    uint64_t counts[NUM_BUCKETS] = {};
+    uint64_t numValues = 0;
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+};
+
+// the histograms and counters of one thread
+struct TurnStats {
+    LatencyHistogram phases[NUM_TURN_PHASES];
+    uint64_t counters[NUM_TURN_COUNTERS] = {};
+};
+
+void recordLatency(LatencyHistogram& histogram, uint64_t value);
+
+uint64_t latencyAtPercentile(const LatencyHistogram& histogram, double percentile);
+
+void mergeLatencyHistogram(LatencyHistogram& histogram, const LatencyHistogram& other);
+
+void recordPhaseLatency(TurnPhase phase, uint64_t nanoseconds);
+
+void countTurnEvent(TurnCounter counter);
+
+void dumpTurnStats(ostream& out);
+
+void installTurnStatsSignal();
+
+void pollTurnStatsSignal(ostream& out);
+
+// times the scope it is declared in as 'phase'
+struct ScopedPhaseTimer {
+    TurnPhase phase;
+    chrono::steady_clock::time_point start;
+
+    explicit ScopedPhaseTimer(TurnPhase phase) : phase(phase), start(chrono::steady_clock::now()) {}
+
+    ~ScopedPhaseTimer() {
+        recordPhaseLatency(phase, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+};
+
+// 'TIME_PHASE(phase)' times the rest of the scope it is in and
+// 'COUNT_TURN_EVENT(counter)' counts one event. the stats are printed to
+// the error stream with 'DUMP_TURN_STATS()', and 'POLL_TURN_STATS()' prints
+// them if SIGUSR1 has come in since it was last called
+#ifdef BATTLESHIP_INSTRUMENT
+#define TURN_STATS_CONCAT_(a, b) a##b
+#define TURN_STATS_CONCAT(a, b) TURN_STATS_CONCAT_(a, b)
+#define TIME_PHASE(phase) ScopedPhaseTimer TURN_STATS_CONCAT(phaseTimer, __LINE__)(phase)
+#define COUNT_TURN_EVENT(counter) countTurnEvent(counter)
+#define DUMP_TURN_STATS() dumpTurnStats(cerr)
+#define INSTALL_TURN_STATS_SIGNAL() installTurnStatsSignal()
+#define POLL_TURN_STATS() pollTurnStatsSignal(cerr)
+#else
+#define TIME_PHASE(phase) ((void)0)
+#define COUNT_TURN_EVENT(counter) ((void)0)
+#define DUMP_TURN_STATS() ((void)0)
+#define INSTALL_TURN_STATS_SIGNAL() ((void)0)
+#define POLL_TURN_STATS() ((void)0)
+#endif
 
 // structs
 struct Point {
@@ -34,26 +206,885 @@ struct Ship {
     int size;
     int hitCount;
     vector<Point> points;
+    // where the ship is listed in the ships file. unlike its place in the
+    // fleet this never changes when ships sink
+    int id;
+};
+
+// a two dimensional array whose size is picked at runtime. the cells are
+// stored row by row in one block of memory, and 'grid[row][col]' works just
+// like it does on a built-in array
+template <typename T>
+struct Grid {
+    int numRows = 0;
+    int numCols = 0;
+    vector<T> cells;
+
+    void resize(int rows, int cols, T value) {
+        numRows = rows;
+        numCols = cols;
+        cells.assign(rows * cols, value);
+    }
+
+    T* operator[](int rowIndex) {
+        return cells.data() + rowIndex * numCols;
+    }
+
+    const T* operator[](int rowIndex) const {
+        return cells.data() + rowIndex * numCols;
+    }
 };
 
+typedef Grid<char> Board;
+
 struct Player {
-    char board[BOARD_ROW_SIZE][BOARD_COL_SIZE];
-    Ship fleet[FLEET_SIZE];
+    Board board;
+    vector<Ship> fleet;
+    // 'shipIds[row][col]' is the index in 'fleet' of the ship on that cell,
+    // or -1 if the cell is empty or its ship has sunk
+    Grid<int> shipIds;
+};
+
+// the fleet of a ships file, read and checked once. it never changes after
+// it is loaded, so every game on every thread starts its fleets by copying
+// 'ships' instead of reading the file again
+struct FleetTemplate {
+    string shipsFile;
+    vector<Ship> ships;
+};
+
+// how a computer picks its shots once it has hit a ship that has not sunk
+enum TargetingEngine {
+    HEURISTIC_TARGETING,
+    MONTE_CARLO_TARGETING,
+};
+
+// the budget of the Monte Carlo targeting engine for one shot. sampling
+// stops after 'maxSamples' fleets or 'timeBudgetMs' milliseconds, whichever
+// comes first. a time budget of 0 means no time limit, which makes every
+// shot depend on the seed alone. with more than one thread the samples are
+// shared out between them in fixed blocks, so the number of threads does
+// not change the shot
+struct MonteCarloSettings {
+    int maxSamples = 1000;
+    double timeBudgetMs = 2.0;
+    int numThreads = 1;
+};
+
+// the limits of the exact endgame solver. it takes over a computer's shots
+// once the ships left can lie in at most 'layoutThreshold' ways, counted
+// as if every ship could take any of its placements on its own. a
+// threshold of 0 turns it off. a solve that runs past 'timeBudgetMs'
+// milliseconds or needs more than 'maxMemoryBytes' to remember partial
+// layouts is given up and the targeting engine picks the shot instead. a
+// time budget of 0 means no time limit, which is the default: a solve cut
+// short by the clock depends on how fast the machine is, so the games of a
+// seed would not always play out the same
+struct ExactSolverSettings {
+    double layoutThreshold = 1000;
+    double timeBudgetMs = 0.0;
+    size_t maxMemoryBytes = 16 << 20;
+};
+
+// how a computer places its fleet
+enum PlacementStrategy {
+    RANDOM_PLACEMENT,
+    ADVERSARIAL_PLACEMENT,
+};
+
+// the budget of the adversarial placement. 'numCandidates' random layouts
+// are hunted by the heuristic targeting engine in simulated games, the
+// layouts sunk quickest are dropped as it goes and the best 'numLayouts'
+// are hunted up to 'maxHunts' times each. the search stops early after
+// 'timeBudgetMs' milliseconds, a time budget of 0 means no time limit,
+// which makes the layouts depend on the config alone. with more than one
+// thread the layouts are hunted in parallel
+struct PlacementSettings {
+    int numCandidates = 256;
+    int maxHunts = 64;
+    int numLayouts = 8;
+    double timeBudgetMs = 1000.0;
+    int numThreads = 1;
+};
+
+struct LayoutBook;
+
+// the board size, the file the fleet is read from and how the computers
+// play. 'engines[0]' and 'placements[0]' are used by computer 1 and
+// 'engines[1]' and 'placements[1]' by computer 2, which is also the
+// computer a human plays against
+struct GameConfig {
+    int numRows = DEFAULT_BOARD_ROW_SIZE;
+    int numCols = DEFAULT_BOARD_COL_SIZE;
+    string shipsFile = "ships.txt";
+    // the fleet in 'shipsFile', loaded once by 'loadFleetTemplate()'. if it
+    // is not set every game reads the file itself
+    shared_ptr<const FleetTemplate> fleetTemplate;
+    TargetingEngine engines[2] = {HEURISTIC_TARGETING, HEURISTIC_TARGETING};
+    MonteCarloSettings monteCarlo;
+    ExactSolverSettings exactSolver;
+    PlacementStrategy placements[2] = {RANDOM_PLACEMENT, RANDOM_PLACEMENT};
+    PlacementSettings placement;
+    // the layouts of the adversarial placement, found by 'findLayoutBook()'.
+    // if it is not set every game looks them up itself
+    shared_ptr<const LayoutBook> layoutBook;
+};
+
+// how a board's cells map onto bits: one bit per cell, row by row. every
+// row gets one extra guard bit that is never set, so shifting a horizontal
+// run of cells can not wrap around into the next row
+struct BitLayout {
+    int numRows;
+    int numCols;
+    int stride;
+    int numWords;
+};
+
+// a board-sized set of bits, a single 64-bit word for the standard board
+struct BitMask {
+    vector<uint64_t> words;
+};
+
+// a ship of 'shipSize' placed at 'rowIndex', 'colIndex' along 'orientation'
+struct Placement {
+    int shipSize;
+    int rowIndex;
+    int colIndex;
+    char orientation;
+};
+
+// the fleet layouts that held out longest against the heuristic targeting
+// engine for one board size, fleet and budget. 'layouts[n]' places the
+// ships of the fleet in order and 'meanShots[n]' is how many shots its
+// hunts took on average to sink them all, best first. 'randomMeanShots'
+// is the same for all the candidates, which were placed at random
+struct LayoutBook {
+    string key;
+    vector<vector<Placement>> layouts;
+    vector<double> meanShots;
+    double randomMeanShots = 0;
+    int numCandidates = 0;
+    long long numHunts = 0;
+    double buildSeconds = 0;
+};
+
+// numbers every placement on an empty board for each distinct ship size of
+// a fleet. the placements of 'shipSizes[s]' are numbered from
+// 'firstPlacement[s]', the horizontal ones row by row first and then the
+// vertical ones, so a placement's number can be worked out from where it is
+// instead of being stored
+struct PlacementTable {
+    int numRows = 0;
+    int numCols = 0;
+    vector<int> shipSizes;
+    vector<int> firstPlacement;
+    vector<int> numHorizontal;
+};
+
+// the hunt mode density a computer keeps up to date between turns. a
+// placement is dropped as soon as a shot lands on one of its cells, and
+// every cell not shot yet sits in the bucket of its current density so a
+// highest density cell can be picked without scanning the board. the
+// buckets share one array, 'cellOrder', that holds the cells sorted by
+// bucket: bucket 'b' is 'cellOrder[bucketStart[b]]' up to
+// 'cellOrder[bucketStart[b + 1]]'. bucket 0 holds the shot cells and a
+// cell that has not been shot is in the bucket one above its density
+struct PlacementIndex {
+    const PlacementTable* table = nullptr;
+    vector<int> numShips;
+    vector<int> numLivePlacements;
+    vector<char> isLive;
+    vector<int> cellDensity;
+    vector<char> isShot;
+    vector<int> cellOrder;
+    vector<int> orderPosition;
+    vector<int> bucketStart;
+    int highestDensity = 0;
+};
+
+// the memory one thread of the Monte Carlo sampler works in. it is kept
+// between shots so sampling does not allocate once it has warmed up
+struct SamplerScratch {
+    GameRng rng;
+    long long numSamples = 0;
+    // how many of the sampled fleets covered each cell, and the cells that
+    // have a count
+    vector<int> occupancy;
+    vector<int> countedCells;
+    // the fleet being sampled: the sizes of the ships still afloat and
+    // where those sizes are in the placement table, the ships not placed
+    // yet, the cells taken so far and the placements the next ship can
+    // choose from
+    vector<int> shipSizes;
+    vector<int> sizeIndices;
+    vector<int> unplacedShips;
+    vector<char> isOccupied;
+    vector<int> placedCells;
+    vector<Placement> candidates;
+    vector<int> candidateShips;
+};
+
+struct SamplerView;
+
+// how the samples of one shot are shared out. the budget of 'maxSamples'
+// fleets is cut into blocks of a fixed size, block 'b' is sampled with the
+// generator 'makeGameRng(seed, b)', and worker 'w' of 'numWorkers' takes
+// blocks 'w', 'w + numWorkers' and so on. the counts of a block depend on
+// its generator alone, so without a deadline a shot comes out the same on
+// any number of threads
+struct SampleBudget {
+    uint64_t seed;
+    int maxSamples;
+    int numWorkers;
+    bool hasDeadline;
+    chrono::steady_clock::time_point deadline;
+};
+
+// the threads a computer samples with besides its own. they are started on
+// the computer's first shot that samples on more than one thread and kept
+// until the computer is gone, so a shot only wakes them. 'round' counts the
+// shots handed to them and 'numBusy' the threads still sampling for the
+// current one, which samples 'view' into 'samplers' within 'budget'. thread
+// 't' works in 'samplers[t + 1]'
+struct SamplerPool {
+    vector<thread> threads;
+    mutex lock;
+    condition_variable wake;
+    condition_variable finished;
+    long long round = 0;
+    int numBusy = 0;
+    bool isStopping = false;
+    const SamplerView* view = nullptr;
+    SamplerScratch* samplers = nullptr;
+    SampleBudget budget;
+
+    ~SamplerPool();
+};
+
+// the sampler threads a computer keeps. they are only a cache, so a copy of
+// the computer starts out without them and starts its own when it needs
+// them, while a move takes them along
+struct SamplerThreads {
+    unique_ptr<SamplerPool> pool;
+
+    SamplerThreads() = default;
+    SamplerThreads(const SamplerThreads&) {}
+    SamplerThreads(SamplerThreads&&) = default;
+
+    SamplerThreads& operator=(const SamplerThreads&) {
+        return *this;
+    }
+
+    SamplerThreads& operator=(SamplerThreads&&) = default;
+};
+
+// the memory of the exact endgame solver, kept between shots like the
+// sampler's. layouts are sets of cells, 'numWords' words of bits each
+struct SolverScratch {
+    int numWords = 0;
+    // the ships still afloat, largest first, as the index of their size in
+    // the placement table
+    vector<int> shipSizeIndices;
+    // the placements a ship of each size can have. the ones of size 's' are
+    // 'candidates[firstCandidate[s]]' up to 'candidates[firstCandidate[s +
+    // 1]]', and the cells of candidate 'c' start at word 'c * numWords' of
+    // 'candidateMasks'
+    vector<Placement> candidates;
+    vector<uint64_t> candidateMasks;
+    vector<int> firstCandidate;
+    // the hits on ships that have not sunk, the cells the ships from each
+    // depth of the search on can reach and the layout at every depth
+    vector<uint64_t> hitMask;
+    vector<uint64_t> reach;
+    vector<uint64_t> layoutStack;
+    // the partial layouts seen so far, an open addressing hash table. slot
+    // 's' holds the layout starting at word 's * numWords' of 'memoKeys',
+    // how many ships it has placed (-1 for an empty slot), the number of
+    // ways to finish it and the number of ways to get to it
+    vector<uint64_t> memoKeys;
+    vector<int> memoDepths;
+    vector<double> memoLayouts;
+    vector<double> memoWeights;
+    vector<int> usedSlots;
+    // the partial layouts of one depth and the next during the count of
+    // the layouts covering each cell
+    vector<int> currentLevel;
+    vector<int> nextLevel;
+    vector<double> cellLayouts;
+    long long numNodes = 0;
+    bool isAborted = false;
+};
+
+// everything a computer player keeps track of between turns
+struct ComputerState {
+    bool isTargeting = false;
+    bool hasShipSunk = false;
+    Grid<double> probabilityDensity;
+    vector<int> touchedCells;
+    vector<Point> potentialPoints;
+    vector<Point> hits;
+    // the cells of the ships this computer has sunk
+    Grid<char> sunkCells;
+    PlacementIndex placementIndex;
+    // the targeting engine, chosen before the game starts
+    TargetingEngine engine = HEURISTIC_TARGETING;
+    MonteCarloSettings monteCarlo;
+    vector<SamplerScratch> samplers;
+    SamplerThreads samplerThreads;
+    ExactSolverSettings exactSolver;
+    SolverScratch solver;
+    // the cell the computer fired at on its last turn
+    Point lastShot;
+    // the layouts the computer places its fleet from, or null to place it
+    // at random
+    const LayoutBook* layoutBook = nullptr;
+};
+
+// how a shot turned out
+enum ShotResult {
+    SHOT_MISS,
+    SHOT_HIT,
+    SHOT_SINK,
+};
+
+// why a shot or a ship placement can not be made, checked without reading
+// or printing anything so the prompts and the server share the rules
+enum MoveError {
+    MOVE_OK,
+    MOVE_INVALID_COORDINATE,
+    MOVE_ALREADY_FIRED,
+    MOVE_INVALID_ORIENTATION,
+    MOVE_OUT_OF_BOUNDS,
+    MOVE_SPACE_OCCUPIED,
+};
+
+// one game being recorded. 'masterSeed' and 'gameIndex' are the numbers its
+// generator was made from, 'gameMode' is the mode of 'play()' or 0 for a
+// headless game. a record is a run of LEB128 varints:
+//
+//   gameMode masterSeed gameIndex numRows numCols numShips
+//   size (cell * 2 + isVertical), for every ship of player 1 and then
+//     player 2, in the order of the ships file
+//   1 + (cell * 8 + result * 2 + shooter) [shipId], for every shot, the
+//     ship id only for a hit or a sink
+//   0 winner
+//
+// where 'cell' is 'row * numCols + col'. 'bytes' is reused from game to game
+struct GameRecorder {
+    uint64_t masterSeed = 0;
+    uint64_t gameIndex = 0;
+    int gameMode = 0;
+    vector<uint8_t> bytes;
+};
+
+// appends finished game records to a file, shared by every thread. the
+// records are gathered in 'buffer' and written out in large blocks. the
+// file starts with the four bytes "BSGR" and a version byte
+struct GameRecordWriter {
+    ofstream out;
+    vector<char> buffer;
+    mutex lock;
+    long long numGames = 0;
+};
+
+// a file of game records mapped into memory
+struct GameRecordFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// reads the records of a mapped file one field at a time. nothing is copied
+// or allocated. 'isCorrupt' is set if a record ends early or has a field out
+// of range
+struct RecordReader {
+    const uint8_t* next = nullptr;
+    const uint8_t* end = nullptr;
+    bool isCorrupt = false;
+};
+
+// the fields at the start of a record, and the winner once every shot has
+// been read
+struct RecordedGame {
+    uint64_t masterSeed;
+    uint64_t gameIndex;
+    int gameMode;
+    int numRows;
+    int numCols;
+    int numShips;
+    int winner = -1;
+};
+
+struct RecordedPlacement {
+    int player;
+    int shipId;
+    int shipSize;
+    int rowIndex;
+    int colIndex;
+    char orientation;
+};
+
+struct RecordedShot {
+    int shooter;
+    int rowIndex;
+    int colIndex;
+    ShotResult result;
+    int shipId;
+};
+
+// everything a game is played with, kept from game to game so a batch of
+// games does not allocate once the first game has sized it. the fleets and
+// the placement index every game starts from are built once per config in
+// 'freshPlayer' and 'freshIndex', and a reset copies them over the last
+// game's state instead of building them again
+struct GameContext {
+    Player players[2];
+    ComputerState computers[2];
+    int numShips[2] = {};
+    int shotsFired[2] = {};
+    Player freshPlayer;
+    PlacementIndex freshIndex;
+    // what the fresh state was built for
+    int numRows = 0;
+    int numCols = 0;
+    const FleetTemplate* fleetTemplate = nullptr;
+};
+
+// where a game stands: the fleets are placed one ship at a time, then the
+// players take turns firing until a fleet is destroyed
+enum GameStage {
+    STAGE_PLACING,
+    STAGE_FIRING,
+    STAGE_OVER,
+};
+
+// a game played as a state machine. it never reads or prints anything: it
+// waits in 'stage' for a move by 'player' (0 or 1), the move is handed to
+// it, and it moves on. the prompts, the simulation, the replay and the
+// server only differ in where the moves come from and what they show of
+// them. 'lastShot' is the shot fired last and 'winner' is set once the game
+// is over, it stays -1 if a computer's fleet could not be placed
+struct GameSession {
+    GameContext* context = nullptr;
+    GameRng* rng = nullptr;
+    GameRecorder* recorder = nullptr;
+    int gameMode = 0;
+    GameStage stage = STAGE_OVER;
+    int player = 0;
+    int shipsPlaced[2] = {};
+    RecordedShot lastShot;
+    int winner = -1;
+};
+
+// the game a replay reuses from game to game, and the placements read from
+// the record being replayed
+struct ReplayScratch {
+    GameContext context;
+    vector<RecordedPlacement> placements;
+};
+
+// results collected over a batch of headless computer vs computer games
+struct SimulationStats {
+    long long numGames = 0;
+    // the games that ended without a winner because a fleet could not be
+    // laid out, which are left out of everything else
+    long long numUnplayable = 0;
+    long long wins[2] = {};
+    long long totalShots[2] = {};
+    // 'shotHistogram[n]' counts the games the winner needed 'n' shots to win
+    vector<long long> shotHistogram;
+};
+
+// where the answers to the game's prompts come from. an interactive source
+// reads from 'cin' like the game always has. a file or a pipe is read
+// straight from its descriptor through 'buffer', and a queue hands out the
+// tokens pushed into it, so scripted games do not go through iostreams.
+// every source gives out the same whitespace separated tokens
+enum InputKind {
+    INPUT_INTERACTIVE,
+    INPUT_FILE,
+    INPUT_PIPE,
+    INPUT_QUEUE,
+};
+
+struct InputSource {
+    InputKind kind = INPUT_INTERACTIVE;
+    int descriptor = -1;
+    vector<char> buffer;
+    size_t next = 0;
+    size_t end = 0;
+    deque<string> queue;
+};
+
+// how the boards are drawn. a full frame is built in 'frame' and written
+// with a single call. the diff mode pins the first frame to the top of the
+// terminal with ANSI escapes and after that only redraws the cells that
+// changed. none draws nothing
+enum RenderMode {
+    RENDER_FULL,
+    RENDER_DIFF,
+    RENDER_NONE,
+};
+
+// the renderer keeps its buffer and the parts of the frame that only depend
+// on the board size from frame to frame. 'shownCells' is what every cell of
+// both boards shows on the terminal, for the diff mode
+struct BoardRenderer {
+    RenderMode mode = RENDER_FULL;
+    string frame;
+    string header;
+    string line;
+    vector<string> rowLabels;
+    vector<char> shownCells;
+    int numRows = 0;
+    int numCols = 0;
+    bool isPinned = false;
+};
+
+// a player waiting to be paired for a game of 'gameMode'. 'player' is what
+// the caller tells its players apart by, the server uses the descriptor of
+// the client. 'queuedAt' is in microseconds since the matchmaker was opened
+// and wraps after about 71 minutes, which only the waits have to survive
+struct MatchTicket {
+    uint32_t player = 0;
+    uint32_t queuedAt = 0;
+    int gameMode = 0;
+};
+
+// a slot of a 'MatchQueue'. its 'sequence' tells the next push or pop whose
+// turn it is to use the slot
+struct MatchQueueCell {
+    atomic<uint64_t> sequence;
+    MatchTicket ticket;
+};
+
+// a bounded multi-producer multi-consumer queue of tickets after Dmitry
+// Vyukov's. a push or a pop claims its slot with one compare-and-swap on its
+// end of the queue and never waits on a lock, and the two ends are kept on
+// cache lines of their own so pushes and pops do not slow each other down
+struct MatchQueue {
+    unique_ptr<MatchQueueCell[]> cells;
+    uint64_t mask = 0;
+    alignas(64) atomic<uint64_t> pushPosition{0};
+    alignas(64) atomic<uint64_t> popPosition{0};
+};
+
+// 'Matchmaker.waiting' when no ticket is waiting for an opponent
+const uint64_t NO_WAITING_TICKET = ~uint64_t(0);
+
+// pairs the players waiting for a game. tickets are queued from any number
+// of threads and any number of threads pair them: a ticket for a game
+// against the computer is matched as soon as it is taken off the queue, one
+// for a game against another player is swapped into 'waiting' and matched
+// with the next one. 'waiting' holds the player and the time of the ticket
+// packed into one word, so taking it or leaving a ticket in it is a single
+// compare-and-swap too. 'maxDepth' is the deepest the queue has been
+struct Matchmaker {
+    MatchQueue queue;
+    alignas(64) atomic<uint64_t> waiting{NO_WAITING_TICKET};
+    atomic<uint64_t> maxDepth{0};
+    chrono::steady_clock::time_point openedAt;
+};
+
+// what a thread pairing tickets has done. the latencies are the waits from
+// a ticket being queued to its match being made, in nanoseconds
+struct MatchmakingStats {
+    long long numPlayerMatches = 0;
+    long long numComputerMatches = 0;
+    LatencyHistogram pairingLatency;
+};
+
+// what a client of the game server is doing
+enum SessionState {
+    SESSION_LOBBY,
+    SESSION_WAITING,
+    SESSION_PLAYING,
+};
+
+// a client connected to the game server, kept in the slot of its
+// descriptor. 'input' holds what has been read but not ended by a newline
+// yet and 'output' what has not been sent yet. 'player' is 0 or 1 in its
+// match. 'queuedAt' is when its ticket was queued while it waits for a game
+struct ServerSession {
+    int descriptor = -1;
+    SessionState state = SESSION_LOBBY;
+    string input;
+    string output;
+    int match = -1;
+    int player = 0;
+    uint32_t queuedAt = 0;
+    bool isFlushQueued = false;
+    bool isWaitingToWrite = false;
+    bool isClosing = false;
+};
+
+// a game hosted by the server between two clients, or a client and the
+// computer. 'sessions' are the descriptors of the players, -1 for the
+// computer. matches are kept and reused once they are over, like the
+// context of a batch of simulated games
+struct ServerMatch {
+    int gameMode = 0;
+    int sessions[2] = {-1, -1};
+    uint64_t gameIndex = 0;
+    GameRng rng;
+    GameContext context;
+    GameSession session;
+    GameRecorder recorder;
+};
+
+// a game server that hosts many games at once on one thread. every socket
+// is non-blocking and waited on with a single epoll descriptor. 'wakeup' is
+// an eventfd that 'stopGameServer()' writes to from any thread or a signal
+// handler. the games are numbered from 0 in the order they start, and
+// every game's generator is made from 'masterSeed' and its number like a
+// simulated game's
+struct GameServer {
+    GameConfig config;
+    uint64_t masterSeed = 0;
+    GameRecordWriter* writer = nullptr;
+    int listener = -1;
+    int epoll = -1;
+    int wakeup = -1;
+    // a descriptor kept open so a connection can still be accepted and
+    // closed again when the process runs out of them
+    int spare = -1;
+    int port = 0;
+    bool isStopping = false;
+    vector<char> readBuffer;
+    vector<ServerSession> sessions;
+    deque<ServerMatch> matches;
+    vector<int> freeMatches;
+    // the clients asking for a game are queued here and paired once the
+    // events read at the same time have been handled
+    Matchmaker matchmaker;
+    MatchmakingStats matchmaking;
+    // the sessions with output to send and the sessions to close once the
+    // events read at the same time have been handled
+    vector<int> flushQueue;
+    vector<int> closeQueue;
+    // the memory of the exact solver and the Monte Carlo sampler is only
+    // used during a computer's turn, so the games lend it from here instead
+    // of keeping their own
+    SolverScratch solver;
+    vector<SamplerScratch> samplers;
+    unique_ptr<SamplerPool> samplerPool;
+    long long numSessions = 0;
+    long long numConnections = 0;
+    long long numGamesStarted = 0;
+    long long numGamesFinished = 0;
 };
 
 // functions
-int chooseGameMode();
+int chooseGameMode(InputSource& input);
+
+string rowLabel(int rowIndex);
+
+bool isValidCoordinate(const char* coordinate, size_t length, int& rowIndex, int& colIndex, int numRows, int numCols);
+
+bool isValidCoordinate(const string& coordinate, int& rowIndex, int& colIndex, int numRows, int numCols);
+
+bool isShipOutOfBounds(char orientation, int shipRowIndex, int shipColIndex, int shipSize, int numRows, int numCols);
+
+bool isIntersect(const Player& player, char orientation, int shipRowIndex, int shipColIndex, int shipSize);
+
+bool checkForHit(Player& player, int& fleetSize, int shotRowIndex, int shotColIndex, char hitSymbol, char missSymbol, bool isComputer, bool& hasShipSunk, bool isVerbose);
+
+bool loadFleetTemplate(FleetTemplate& fleet, const string& shipsFile, string& error);
+
+bool checkFleetFits(const FleetTemplate& fleet, int numRows, int numCols, string& error);
+
+void initFleet(Player& player, const GameConfig& config);
+
+bool spaceOccupied(const Player& player, int shipRowIndices, int shipColIndices, char orientation, int shipSize);
+
+MoveError checkShipPlacement(const Player& player, int shipRowIndex, int shipColIndex, char orientation, int shipSize);
+
+MoveError checkShot(const Player& player, const char* coordinate, size_t length, int& shotRowIndex, int& shotColIndex, char hitSymbol, char missSymbol);
+
+void placeShipAt(Player& player, int shipIndex, int rowIndex, int colIndex, char orientation);
+
+void getValidShipInfo(Player& player, int& rowIndex, int& colIndex, char& orientation, int shipIndex, InputSource& input);
+
+void placeShip(GameSession& session, InputSource& input);
+
+void boardSetup(GameSession& session, InputSource& input, BoardRenderer& renderer);
+
+bool play(GameContext& context, int gameMode, const GameConfig& config, GameRng& rng, GameRecorder* recorder, InputSource& input, BoardRenderer& renderer);
+
+bool computerStartShipPlacement(Player& player1, Player& computer, GameRng& rng);
+
+void calculateProbabilityDensity(const Player& player, int fleetSize, Grid<double>& probabilityDensity, vector<int>& touchedCells, vector<Point>& hits, bool& isTargeting, Point& targetShot, bool hasShipSunk, const Grid<char>& sunkCells, GameRng& rng);
+
+void resetComputerState(ComputerState& computer);
+
+void prepareTargeting(ComputerState& computer, int numRows, int numCols);
+
+bool computerTurn(Player& opponent, int& opponentNumShips, ComputerState& computer, GameRng& rng, bool isVerbose);
+
+// bitboards
+BitLayout makeBitLayout(int numRows, int numCols);
+
+BitMask emptyMask(const BitLayout& layout);
+
+void setBit(const BitLayout& layout, BitMask& mask, int rowIndex, int colIndex);
+
+bool testBit(const BitLayout& layout, const BitMask& mask, int rowIndex, int colIndex);
+
+BitMask boardCellsMask(const BitLayout& layout);
+
+BitMask maskAnd(const BitMask& a, const BitMask& b);
+
+BitMask maskOr(const BitMask& a, const BitMask& b);
+
+BitMask maskAndNot(const BitMask& a, const BitMask& b);
+
+bool isMaskEmpty(const BitMask& mask);
+
+int countBits(const BitMask& mask);
+
+BitMask maskShiftRight(const BitMask& mask, int shift);
+
+BitMask maskShiftLeft(const BitMask& mask, int shift);
+
+BitMask placementStarts(const BitLayout& layout, const BitMask& freeCells, int shipSize, char orientation);
+
+bool sampleFleetLayout(const BitLayout& layout, const vector<Ship>& fleet, GameRng& rng, vector<Placement>& placements, long long maxBacktracks);
+
+// placements
+const PlacementTable& getPlacementTable(int numRows, int numCols, const vector<Ship>& fleet, int fleetSize);
+
+Placement getPlacement(const PlacementTable& table, int sizeIndex, int placement);
+
+void initPlacementIndex(PlacementIndex& index, int numRows, int numCols, const vector<Ship>& fleet, int fleetSize);
+
+void recordShot(PlacementIndex& index, int rowIndex, int colIndex);
+
+void recordSunkShip(PlacementIndex& index, int shipSize);
+
+bool pickHighestDensityCell(PlacementIndex& index, int& rowIndex, int& colIndex, GameRng& rng);
+
+// monte carlo
+bool sampleTargetShot(const Player& opponent, int fleetSize, ComputerState& computer, Point& targetShot, GameRng& rng);
+
+// exact solver
+bool solveEndgameShot(const Player& opponent, int fleetSize, ComputerState& computer, Point& targetShot, GameRng& rng);
+
+// game records
+void startGameRecord(GameRecorder& recorder, const Player& player1, const Player& player2);
+
+ShotResult classifyShot(const Player& target, int targetNumShips, int numShipsBefore, int rowIndex, int colIndex, int& shipId);
+
+void recordShotEvent(GameRecorder& recorder, int shooter, const Player& target, int targetNumShips, int numShipsBefore, int rowIndex, int colIndex);
+
+void finishGameRecord(GameRecorder& recorder, int winner);
+
+bool openGameRecordWriter(GameRecordWriter& writer, const string& path);
+
+void writeGameRecord(GameRecordWriter& writer, const GameRecorder& recorder);
+
+void closeGameRecordWriter(GameRecordWriter& writer);
+
+bool openGameRecordFile(GameRecordFile& file, const string& path);
+
+void closeGameRecordFile(GameRecordFile& file);
+
+RecordReader makeRecordReader(const GameRecordFile& file);
+
+bool readGameHeader(RecordReader& reader, RecordedGame& game);
+
+bool readPlacement(RecordReader& reader, const RecordedGame& game, int placementIndex, RecordedPlacement& placement);
+
+bool readShot(RecordReader& reader, RecordedGame& game, RecordedShot& shot);
+
+bool summarizeGameRecords(const string& path);
+
+// game sessions
+bool isComputerPlayer(int gameMode, int player);
+
+void startGameSession(GameSession& session, GameContext& context, int gameMode, const GameConfig& config, GameRng& rng, GameRecorder* recorder);
+
+MoveError placeSessionShip(GameSession& session, int player, int rowIndex, int colIndex, char orientation);
+
+MoveError fireSessionShot(GameSession& session, int rowIndex, int colIndex);
+
+bool playComputerMove(GameSession& session);
+
+bool isComputerToMove(const GameSession& session);
+
+// replay
+bool replayGame(RecordReader& reader, const GameConfig& config, ReplayScratch& scratch, RecordedGame& game, string& divergence);
+
+bool replayGameRecords(const string& path, const GameConfig& config, int numThreads);
+
+// input
+bool openInputFile(InputSource& input, const string& path);
+
+void openInputPipe(InputSource& input, int descriptor);
+
+void openInputQueue(InputSource& input);
+
+void pushInput(InputSource& input, const string& token);
+
+void closeInput(InputSource& input);
+
+bool readToken(InputSource& input, string& token);
+
+void readRequiredToken(InputSource& input, string& token);
+
+// rendering
+void displayBoards(BoardRenderer& renderer, const Board& board1, const Board& board2, bool isGameStart);
+
+void closeRenderer(BoardRenderer& renderer);
+
+// simulation
+GameRng makeGameRng(uint64_t masterSeed, uint64_t gameIndex);
+
+void resetGameContext(GameContext& context, const GameConfig& config);
+
+int simulateGame(GameContext& context, const GameConfig& config, GameRng& rng, GameRecorder* recorder);
+
+void runSimulations(long long firstGame, long long numGames, uint64_t masterSeed, const GameConfig& config, GameContext& context, GameRecorder& recorder, SimulationStats& stats, GameRecordWriter* writer);
+
+void mergeSimulationStats(SimulationStats& stats, const SimulationStats& other);
+
+void runParallel(int numTasks, int numThreads, const function<void(int task, int worker)>& runTask);
+
+void runTournament(long long numGames, int numThreads, uint64_t masterSeed, const GameConfig& config, SimulationStats& stats, GameRecordWriter* writer);
+
+void printSimulationStats(const SimulationStats& stats, double elapsedSeconds);
+
+// matchmaking
+void openMatchQueue(MatchQueue& queue, int capacity);
+
+bool pushMatchTicket(MatchQueue& queue, const MatchTicket& ticket);
+
+bool popMatchTicket(MatchQueue& queue, MatchTicket& ticket);
+
+uint64_t matchQueueDepth(const MatchQueue& queue);
+
+void openMatchmaker(Matchmaker& matchmaker, int capacity);
+
+uint32_t matchmakerClock(const Matchmaker& matchmaker);
+
+bool queueMatchTicket(Matchmaker& matchmaker, uint32_t player, int gameMode, uint32_t& queuedAt);
+
+bool cancelMatchTicket(Matchmaker& matchmaker, uint32_t player, uint32_t queuedAt);
+
+int pairMatchTickets(Matchmaker& matchmaker, MatchmakingStats& stats, int maxTickets, const function<void(const MatchTicket& first, const MatchTicket* second)>& startMatch);
+
+void mergeMatchmakingStats(MatchmakingStats& stats, const MatchmakingStats& other);
 
-void displayBoards(char board1[][BOARD_COL_SIZE], char board2[][BOARD_COL_SIZE], bool isGameStart);
+// adversarial placement
+shared_ptr<const LayoutBook> findLayoutBook(const GameConfig& config);
 
-void initFleet(Player& player);
+void placeBookLayout(Player& computer, const LayoutBook& book, GameRng& rng);
 
-bool spaceOccupied(Player player, int shipRowIndices, int shipColIndices, char orientation, int shipSize);
+// server
+bool openGameServer(GameServer& server, const string& address, int port, string& error);
 
-void getValidShipInfo(Player& player, int& rowIndex, int& colIndex, char& orientation, int shipIndex);
+void runGameServer(GameServer& server);
 
-void placeShip(Player& player, int shipIndex);
+void stopGameServer(GameServer& server);
 
-void boardSetup(Player& player1, Player& player2, int gameMode);
+void installServerStopSignals(GameServer& server);
 
-void play(Player& player1, Player& player2, int gameMode);
\ No newline at end of file
+void closeGameServer(GameServer& server);
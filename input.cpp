@@ -0,0 +1,145 @@
+#include "header.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+// how much of a file or a pipe is read at a time
+const size_t INPUT_BUFFER_BYTES = 1 << 16;
+
+// function sets up 'input' to read from 'descriptor' as a source of 'kind'
+void openInputDescriptor(InputSource& input, InputKind kind, int descriptor) {
+    input.kind = kind;
+    input.descriptor = descriptor;
+    input.buffer.resize(INPUT_BUFFER_BYTES);
+    input.next = 0;
+    input.end = 0;
+}
+
+// function makes 'input' read the script in the file 'path'. returns false if
+// the file can not be opened
+bool openInputFile(InputSource& input, const string& path) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+
+    if (descriptor < 0) {
+        return false;
+    }
+
+    openInputDescriptor(input, INPUT_FILE, descriptor);
+
+    return true;
+}
+
+// function makes 'input' read from the pipe 'descriptor', usually standard
+// input. the tokens are used as soon as they arrive, so a program on the
+// other end can answer the prompts one at a time
+void openInputPipe(InputSource& input, int descriptor) {
+    openInputDescriptor(input, INPUT_PIPE, descriptor);
+}
+
+// function makes 'input' hand out the tokens given to 'pushInput()'
+void openInputQueue(InputSource& input) {
+    input.kind = INPUT_QUEUE;
+    input.queue.clear();
+}
+
+// function adds 'token' to the end of a queue source
+void pushInput(InputSource& input, const string& token) {
+    input.queue.push_back(token);
+}
+
+// function closes the file of a file source and makes 'input' interactive
+// again
+void closeInput(InputSource& input) {
+    if (input.kind == INPUT_FILE) {
+        close(input.descriptor);
+    }
+
+    input.kind = INPUT_INTERACTIVE;
+    input.descriptor = -1;
+    input.queue.clear();
+}
+
+// function reads more of a file or pipe into the buffer. returns false at
+// the end of the input
+bool fillInputBuffer(InputSource& input) {
+    // 'cin' would flush the prompts before waiting for an answer, a pipe has
+    // to do it itself or the other end never sees them
+    if (input.kind == INPUT_PIPE) {
+        cout.flush();
+    }
+
+    while (true) {
+        ssize_t numRead = read(input.descriptor, input.buffer.data(), input.buffer.size());
+
+        if (numRead < 0 && errno == EINTR) {
+            continue;
+        }
+
+        input.next = 0;
+        input.end = max<ssize_t>(0, numRead);
+
+        return numRead > 0;
+    }
+}
+
+// function reads the next whitespace separated token from 'input' into
+// 'token'. returns false if the input has ended
+bool readToken(InputSource& input, string& token) {
+    if (input.kind == INPUT_INTERACTIVE) {
+        return bool(cin >> token);
+    }
+
+    if (input.kind == INPUT_QUEUE) {
+        if (input.queue.empty()) {
+            return false;
+        }
+
+        token.swap(input.queue.front());
+        input.queue.pop_front();
+
+        return true;
+    }
+
+    token.clear();
+
+    // skips the whitespace in front of the token
+    while (true) {
+        if (input.next == input.end && !fillInputBuffer(input)) {
+            return false;
+        }
+
+        while (input.next < input.end && isspace((unsigned char)input.buffer[input.next])) {
+            input.next++;
+        }
+
+        if (input.next < input.end) {
+            break;
+        }
+    }
+
+    // a token can run over the end of the buffer, so it is gathered a
+    // piece at a time
+    while (true) {
+        size_t start = input.next;
+
+        while (input.next < input.end && !isspace((unsigned char)input.buffer[input.next])) {
+            input.next++;
+        }
+
+        token.append(input.buffer.data() + start, input.next - start);
+
+        if (input.next < input.end || !fillInputBuffer(input)) {
+            return true;
+        }
+    }
+}
+
+// function reads the next token like 'readToken()'. a prompt can not be
+// answered once the input has ended, so the game stops there
+void readRequiredToken(InputSource& input, string& token) {
+    if (!readToken(input, token)) {
+        cout << "\nThe input ended before the game did.\n";
+        exit(1);
+    }
+}
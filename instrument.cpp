@@ -0,0 +1,249 @@
+#include "header.h"
+
+// the stats a thread records into while a dump may read them from another
+// thread. only the thread itself writes them, so an update is a relaxed load
+// and store rather than a locked add, and costs what a plain increment does
+struct LiveLatencyHistogram {
+    atomic<uint64_t> counts[LatencyHistogram::NUM_BUCKETS] = {};
+    atomic<uint64_t> numValues{0};
+    atomic<uint64_t> total{0};
+    atomic<uint64_t> maxValue{0};
+};
+
+struct LiveTurnStats {
+    LiveLatencyHistogram phases[NUM_TURN_PHASES];
+    atomic<uint64_t> counters[NUM_TURN_COUNTERS] = {};
+};
+
+// every thread records into its own stats, so timing a phase never takes a
+// lock. the stats of every thread are listed here so a dump can add them
+// up, and a thread that finishes adds its stats into 'retiredStats' first
+static mutex turnStatsLock;
+static vector<LiveTurnStats*> liveTurnStats;
+static TurnStats retiredStats;
+
+// set by the signal handler, picked up by 'pollTurnStatsSignal()'
+static atomic<bool> isDumpRequested(false);
+
+// function returns the bucket 'value' is counted in. values below
+// 'SUB_BUCKETS' get a bucket each, larger ones share a bucket with the
+// values that agree with them in their top 'SUB_BUCKET_BITS' + 1 bits
+int latencyBucket(uint64_t value) {
+    const int subBucketBits = LatencyHistogram::SUB_BUCKET_BITS;
+
+    if (value < (uint64_t)LatencyHistogram::SUB_BUCKETS) {
+        return value;
+    }
+
+    int magnitude = 63 - __builtin_clzll(value);
+    int shift = magnitude - subBucketBits;
+
+    return ((shift + 1) << subBucketBits) + (int)((value >> shift) - LatencyHistogram::SUB_BUCKETS);
+}
+
+// function returns the largest value counted in 'bucket'
+uint64_t bucketHighestValue(int bucket) {
+    const int subBucketBits = LatencyHistogram::SUB_BUCKET_BITS;
+
+    if (bucket < LatencyHistogram::SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int shift = (bucket >> subBucketBits) - 1;
+    uint64_t lowest = (uint64_t)((bucket & (LatencyHistogram::SUB_BUCKETS - 1)) + LatencyHistogram::SUB_BUCKETS) << shift;
+
+    return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+// function adds 'value' to 'histogram'
+void recordLatency(LatencyHistogram& histogram, uint64_t value) {
+    histogram.counts[latencyBucket(value)]++;
+    histogram.numValues++;
+    histogram.total += value;
+    histogram.maxValue = max(histogram.maxValue, value);
+}
+
+// function returns the latency that 'percentile' percent of the values in
+// 'histogram' are at or below, to within the width of its bucket
+uint64_t latencyAtPercentile(const LatencyHistogram& histogram, double percentile) {
+    if (histogram.numValues == 0) {
+        return 0;
+    }
+
+    uint64_t rank = max<uint64_t>(1, (uint64_t)(percentile / 100.0 * histogram.numValues + 0.5));
+    uint64_t seen = 0;
+
+    for (int bucket = 0; bucket < LatencyHistogram::NUM_BUCKETS; bucket++) {
+        seen += histogram.counts[bucket];
+
+        if (seen >= rank) {
+            return min(bucketHighestValue(bucket), histogram.maxValue);
+        }
+    }
+
+    return histogram.maxValue;
+}
+
+// function adds the latencies in 'other' into 'histogram'
+void mergeLatencyHistogram(LatencyHistogram& histogram, const LatencyHistogram& other) {
+    for (int bucket = 0; bucket < LatencyHistogram::NUM_BUCKETS; bucket++) {
+        histogram.counts[bucket] += other.counts[bucket];
+    }
+
+    histogram.numValues += other.numValues;
+    histogram.total += other.total;
+    histogram.maxValue = max(histogram.maxValue, other.maxValue);
+}
+
+// function adds the stats in 'other' into 'stats'
+void mergeTurnStats(TurnStats& stats, const TurnStats& other) {
+    for (int phase = 0; phase < NUM_TURN_PHASES; phase++) {
+        mergeLatencyHistogram(stats.phases[phase], other.phases[phase]);
+    }
+
+    for (int counter = 0; counter < NUM_TURN_COUNTERS; counter++) {
+        stats.counters[counter] += other.counters[counter];
+    }
+}
+
+// function sets 'value', which only the calling thread writes, to 'update'
+void storeLive(atomic<uint64_t>& value, uint64_t update) {
+    value.store(update, memory_order_relaxed);
+}
+
+uint64_t loadLive(const atomic<uint64_t>& value) {
+    return value.load(memory_order_relaxed);
+}
+
+// function adds what 'live' holds so far into 'stats'
+void mergeLiveTurnStats(TurnStats& stats, const LiveTurnStats& live) {
+    for (int phase = 0; phase < NUM_TURN_PHASES; phase++) {
+        LatencyHistogram& histogram = stats.phases[phase];
+        const LiveLatencyHistogram& other = live.phases[phase];
+
+        for (int bucket = 0; bucket < LatencyHistogram::NUM_BUCKETS; bucket++) {
+            histogram.counts[bucket] += loadLive(other.counts[bucket]);
+        }
+
+        histogram.numValues += loadLive(other.numValues);
+        histogram.total += loadLive(other.total);
+        histogram.maxValue = max(histogram.maxValue, loadLive(other.maxValue));
+    }
+
+    for (int counter = 0; counter < NUM_TURN_COUNTERS; counter++) {
+        stats.counters[counter] += loadLive(live.counters[counter]);
+    }
+}
+
+// the stats of the calling thread, listed the first time a thread records
+// anything and taken off the list when the thread finishes
+struct ThreadTurnStats {
+    LiveTurnStats stats;
+
+    ThreadTurnStats() {
+        lock_guard<mutex> guard(turnStatsLock);
+        liveTurnStats.push_back(&stats);
+    }
+
+    ~ThreadTurnStats() {
+        lock_guard<mutex> guard(turnStatsLock);
+
+        mergeLiveTurnStats(retiredStats, stats);
+        liveTurnStats.erase(remove(liveTurnStats.begin(), liveTurnStats.end(), &stats), liveTurnStats.end());
+    }
+};
+
+LiveTurnStats& threadTurnStats() {
+    static thread_local ThreadTurnStats threadStats;
+
+    return threadStats.stats;
+}
+
+// function records that 'phase' took 'nanoseconds', the same way
+// 'recordLatency()' does
+void recordPhaseLatency(TurnPhase phase, uint64_t nanoseconds) {
+    LiveLatencyHistogram& histogram = threadTurnStats().phases[phase];
+    atomic<uint64_t>& count = histogram.counts[latencyBucket(nanoseconds)];
+
+    storeLive(count, loadLive(count) + 1);
+    storeLive(histogram.numValues, loadLive(histogram.numValues) + 1);
+    storeLive(histogram.total, loadLive(histogram.total) + nanoseconds);
+    storeLive(histogram.maxValue, max(loadLive(histogram.maxValue), nanoseconds));
+}
+
+// function counts one 'counter' event
+void countTurnEvent(TurnCounter counter) {
+    atomic<uint64_t>& count = threadTurnStats().counters[counter];
+
+    storeLive(count, loadLive(count) + 1);
+}
+
+// function prints the latency histograms of every phase and the counters,
+// added up over every thread. the stats of a thread that is still running
+// are read while it records, so their counts may not quite agree with each
+// other
+void dumpTurnStats(ostream& out) {
+    const char* phaseNames[NUM_TURN_PHASES] = {"density", "shot selection", "hit resolution", "rendering"};
+    const char* counterNames[NUM_TURN_COUNTERS] = {"computer turns", "hits", "exact solves", "Monte Carlo shots"};
+    const double percentiles[] = {50, 90, 99, 99.9};
+    const char* percentileNames[] = {"p50", "p90", "p99", "p99.9"};
+
+    TurnStats total;
+
+    {
+        lock_guard<mutex> guard(turnStatsLock);
+
+        mergeTurnStats(total, retiredStats);
+
+        for (const LiveTurnStats* stats : liveTurnStats) {
+            mergeLiveTurnStats(total, *stats);
+        }
+    }
+
+    out << "Turn latencies (ns):\n";
+    out << "  " << left << setw(16) << "phase" << right << setw(12) << "count" << setw(10) << "mean";
+
+    for (const char* name : percentileNames) {
+        out << setw(10) << name;
+    }
+
+    out << setw(12) << "max" << "\n";
+
+    for (int phase = 0; phase < NUM_TURN_PHASES; phase++) {
+        const LatencyHistogram& histogram = total.phases[phase];
+
+        out << "  " << left << setw(16) << phaseNames[phase] << right << setw(12) << histogram.numValues << setw(10) << histogram.total / max<uint64_t>(1, histogram.numValues);
+
+        for (double percentile : percentiles) {
+            out << setw(10) << latencyAtPercentile(histogram, percentile);
+        }
+
+        out << setw(12) << histogram.maxValue << "\n";
+    }
+
+    out << "Counters:\n";
+
+    for (int counter = 0; counter < NUM_TURN_COUNTERS; counter++) {
+        out << "  " << left << setw(20) << counterNames[counter] << right << setw(12) << total.counters[counter] << "\n";
+    }
+}
+
+// function is the SIGUSR1 handler. printing is not safe in a handler, so it
+// only asks for a dump
+void requestTurnStatsDump(int) {
+    isDumpRequested = true;
+}
+
+// function makes SIGUSR1 ask for a dump of the stats, on systems that have it
+void installTurnStatsSignal() {
+#ifdef SIGUSR1
+    signal(SIGUSR1, requestTurnStatsDump);
+#endif
+}
+
+// function prints the stats if a dump has been asked for since the last call
+void pollTurnStatsSignal(ostream& out) {
+    if (isDumpRequested.exchange(false)) {
+        dumpTurnStats(out);
+    }
+}
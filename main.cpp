@@ -1,13 +1,304 @@
 #include "header.h"
 
-int main() {
-    // declare player1 and player2's boards
-    Player player1, player2;
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+    // '--simulate <games>' runs headless computer vs computer games and
+    // reports the results instead of starting an interactive game.
+    // '--threads <count>' spreads the games over several threads and
+    // '--seed <seed>' makes the batch reproducible. '--rows <rows>',
+    // '--cols <cols>' and '--ships <file>' change the board size and the file
+    // the fleet is read from.
+    //
+    // '--engine <heuristic|montecarlo>' picks how both computers target
+    // ships they have hit, '--engine1' and '--engine2' pick it for one of
+    // them. '--samples <count>', '--time-budget <ms>' and '--sample-threads
+    // <count>' set the budget of the Monte Carlo engine for each shot.
+    // '--exact-threshold <layouts>', '--exact-time-budget <ms>' and
+    // '--exact-memory <MB>' set when the exact endgame solver takes over and
+    // how far it may go, a threshold of 0 turns it off. without a time
+    // budget, the default, a seed plays the same games on any machine.
+    //
+    // '--placement <random|adversarial>' picks how both computers place
+    // their fleets, '--placement1' and '--placement2' pick it for one of
+    // them. an adversarial computer places its fleet like one of the layouts
+    // that held out longest in simulated hunts, which '--placement-candidates
+    // <count>', '--placement-hunts <count>', '--placement-layouts <count>',
+    // '--placement-time-budget <ms>' and '--placement-threads <count>'
+    // budget. a replay reproduces adversarial placements only when it is run
+    // with the same placement options and '--placement-time-budget 0'.
+    //
+    // '--record <file>' writes the placements and every shot of the games
+    // to a binary game-record file, '--analyze <file>' reads one back and
+    // prints what is in it, and '--replay <file>' plays every game in one
+    // again from its seed, headless, checking that the computers make the
+    // same decisions as in the record.
+    //
+    // '--input <file>' answers the prompts of an interactive game from a
+    // script, '-' reads them from standard input, which is also used when
+    // standard input is a pipe or a file rather than a terminal. '--render
+    // <full|diff|none>' draws the boards in full after every shot, redraws
+    // only the cells that changed on an ANSI terminal, or skips drawing
+    // them.
+    //
+    // '--serve <port>' hosts player vs player and player vs computer games
+    // for TCP clients instead, on the address given with '--bind', 127.0.0.1
+    // unless it is set, until it gets SIGINT or SIGTERM. the games are
+    // recorded with '--record'. a build with BATTLESHIP_INSTRUMENT defined
+    // times every turn, and prints the stats at the end or when it gets
+    // SIGUSR1
+    const int maxBoardSize = 1000;
+
+    GameConfig config;
+    long long numGames = 0;
+    int numThreads = thread::hardware_concurrency();
+    uint64_t masterSeed = chrono::steady_clock::now().time_since_epoch().count();
+    string recordFile, analyzeFile, replayFile, inputFile;
+    string bindAddress = "127.0.0.1";
+    int serverPort = -1;
+    BoardRenderer renderer;
+
+    INSTALL_TURN_STATS_SIGNAL();
+
+    for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2) {
+        string option = argv[argIndex];
+
+        if (option == "--simulate") {
+            numGames = atoll(argv[argIndex + 1]);
+        } else if (option == "--threads") {
+            numThreads = atoi(argv[argIndex + 1]);
+        } else if (option == "--seed") {
+            masterSeed = strtoull(argv[argIndex + 1], nullptr, 10);
+        } else if (option == "--rows") {
+            config.numRows = atoi(argv[argIndex + 1]);
+        } else if (option == "--cols") {
+            config.numCols = atoi(argv[argIndex + 1]);
+        } else if (option == "--ships") {
+            config.shipsFile = argv[argIndex + 1];
+        } else if (option == "--engine" || option == "--engine1" || option == "--engine2") {
+            string name = argv[argIndex + 1];
+
+            if (name != "heuristic" && name != "montecarlo") {
+                cout << "Unknown targeting engine: " << name << "\n";
+                return 1;
+            }
+
+            TargetingEngine engine = (name == "montecarlo") ? MONTE_CARLO_TARGETING : HEURISTIC_TARGETING;
+
+            if (option != "--engine2") {
+                config.engines[0] = engine;
+            }
+
+            if (option != "--engine1") {
+                config.engines[1] = engine;
+            }
+        } else if (option == "--placement" || option == "--placement1" || option == "--placement2") {
+            string name = argv[argIndex + 1];
+
+            if (name != "random" && name != "adversarial") {
+                cout << "Unknown placement: " << name << "\n";
+                return 1;
+            }
+
+            PlacementStrategy placement = (name == "adversarial") ? ADVERSARIAL_PLACEMENT : RANDOM_PLACEMENT;
+
+            if (option != "--placement2") {
+                config.placements[0] = placement;
+            }
+
+            if (option != "--placement1") {
+                config.placements[1] = placement;
+            }
+        } else if (option == "--placement-candidates") {
+            config.placement.numCandidates = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--placement-hunts") {
+            config.placement.maxHunts = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--placement-layouts") {
+            config.placement.numLayouts = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--placement-time-budget") {
+            config.placement.timeBudgetMs = max(0.0, atof(argv[argIndex + 1]));
+        } else if (option == "--placement-threads") {
+            config.placement.numThreads = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--samples") {
+            config.monteCarlo.maxSamples = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--time-budget") {
+            config.monteCarlo.timeBudgetMs = max(0.0, atof(argv[argIndex + 1]));
+        } else if (option == "--sample-threads") {
+            config.monteCarlo.numThreads = max(1, atoi(argv[argIndex + 1]));
+        } else if (option == "--exact-threshold") {
+            config.exactSolver.layoutThreshold = max(0.0, atof(argv[argIndex + 1]));
+        } else if (option == "--exact-time-budget") {
+            config.exactSolver.timeBudgetMs = max(0.0, atof(argv[argIndex + 1]));
+        } else if (option == "--exact-memory") {
+            config.exactSolver.maxMemoryBytes = (size_t)(max(1.0, atof(argv[argIndex + 1])) * (1 << 20));
+        } else if (option == "--record") {
+            recordFile = argv[argIndex + 1];
+        } else if (option == "--analyze") {
+            analyzeFile = argv[argIndex + 1];
+        } else if (option == "--replay") {
+            replayFile = argv[argIndex + 1];
+        } else if (option == "--input") {
+            inputFile = argv[argIndex + 1];
+        } else if (option == "--serve") {
+            serverPort = atoi(argv[argIndex + 1]);
+        } else if (option == "--bind") {
+            bindAddress = argv[argIndex + 1];
+        } else if (option == "--render") {
+            string name = argv[argIndex + 1];
+
+            if (name != "full" && name != "diff" && name != "none") {
+                cout << "Unknown render mode: " << name << "\n";
+                return 1;
+            }
+
+            renderer.mode = (name == "diff") ? RENDER_DIFF : (name == "none") ? RENDER_NONE : RENDER_FULL;
+        }
+    }
+
+    if (!analyzeFile.empty()) {
+        return summarizeGameRecords(analyzeFile) ? 0 : 1;
+    }
+
+    // the ships file is read once, every game copies its fleet from here
+    auto fleetTemplate = make_shared<FleetTemplate>();
+    string fleetError;
+
+    if (!loadFleetTemplate(*fleetTemplate, config.shipsFile, fleetError)) {
+        cout << fleetError << "\n";
+        return 1;
+    }
+
+    config.fleetTemplate = fleetTemplate;
+
+    if (!replayFile.empty()) {
+        return replayGameRecords(replayFile, config, numThreads) ? 0 : 1;
+    }
+
+    if (config.numRows < 1 || config.numRows > maxBoardSize || config.numCols < 1 || config.numCols > maxBoardSize) {
+        cout << "The board must have between 1 and " << maxBoardSize << " rows and columns.\n";
+        return 1;
+    }
+
+    if (!checkFleetFits(*fleetTemplate, config.numRows, config.numCols, fleetError)) {
+        cout << fleetError << "\n";
+        return 1;
+    }
+
+    // the adversarial layouts are found once, before any game starts
+    if (config.placements[0] == ADVERSARIAL_PLACEMENT || config.placements[1] == ADVERSARIAL_PLACEMENT) {
+        config.layoutBook = findLayoutBook(config);
+
+        const LayoutBook& book = *config.layoutBook;
+
+        cout << fixed << setprecision(2);
+        cout << "Placement: kept " << book.layouts.size() << " of " << book.numCandidates << " layouts after " << book.numHunts << " hunts in " << book.buildSeconds << "s, ";
+        cout << "sunk in " << book.meanShots.back() << " to " << book.meanShots.front() << " shots against " << book.randomMeanShots << " for a random layout\n";
+    }
+
+    GameRecordWriter writer;
+
+    if (!recordFile.empty() && !openGameRecordWriter(writer, recordFile)) {
+        cout << "Can not write game records to " << recordFile << "\n";
+        return 1;
+    }
+
+    if (serverPort >= 0) {
+        GameServer server;
+        string serverError;
+
+        server.config = config;
+        server.masterSeed = masterSeed;
+        server.writer = recordFile.empty() ? nullptr : &writer;
+
+        if (!openGameServer(server, bindAddress, serverPort, serverError)) {
+            cout << serverError << "\n";
+            return 1;
+        }
+
+        installServerStopSignals(server);
+
+        cout << "Seed: " << masterSeed << ", serving on " << bindAddress << ":" << server.port << endl;
+
+        runGameServer(server);
+
+        cout << "Served " << server.numGamesFinished << " finished games of " << server.numGamesStarted << " to " << server.numConnections << " clients\n";
+
+        const MatchmakingStats& matchmaking = server.matchmaking;
+
+        cout << "Paired " << matchmaking.numPlayerMatches << " games between clients and " << matchmaking.numComputerMatches << " against the computer, queue depth up to " << server.matchmaker.maxDepth << "\n";
+        cout << "Wait to be paired (us): p50 " << latencyAtPercentile(matchmaking.pairingLatency, 50) / 1000 << ", p99 " << latencyAtPercentile(matchmaking.pairingLatency, 99) / 1000 << ", max " << matchmaking.pairingLatency.maxValue / 1000 << "\n";
+
+        closeGameServer(server);
+
+        if (!recordFile.empty()) {
+            closeGameRecordWriter(writer);
+        }
+
+        return 0;
+    }
+
+    if (numGames > 0) {
+        SimulationStats stats;
+
+        cout << "Seed: " << masterSeed << ", threads: " << max(1, numThreads) << "\n";
+
+        auto start = chrono::steady_clock::now();
+        runTournament(numGames, numThreads, masterSeed, config, stats, recordFile.empty() ? nullptr : &writer);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+        if (!recordFile.empty()) {
+            closeGameRecordWriter(writer);
+        }
+
+        printSimulationStats(stats, elapsed.count());
+        DUMP_TURN_STATS();
+        return (stats.numUnplayable > 0) ? 1 : 0;
+    }
+
+    // a script or a pipe is read without going through 'cin', and the
+    // output no longer has to be kept in step with C's stdio either
+    InputSource input;
+
+    if (inputFile == "-" || (inputFile.empty() && !isatty(STDIN_FILENO))) {
+        openInputPipe(input, STDIN_FILENO);
+    } else if (!inputFile.empty() && !openInputFile(input, inputFile)) {
+        cout << "Can not read input from " << inputFile << "\n";
+        return 1;
+    }
+
+    if (input.kind != INPUT_INTERACTIVE) {
+        ios::sync_with_stdio(false);
+    }
+
+    // provides a seed value for the computer's random choices. the same
+    // seed with '--seed' plays the computer's side of the game again
+    GameRng rng = makeGameRng(masterSeed, 0);
+
+    cout << "Seed: " << masterSeed << "\n";
+
+    // the players' boards and the computers
+    GameContext context;
 
     // selects the game mode
-    int gameMode = chooseGameMode();
+    int gameMode = chooseGameMode(input);
+
+    // the game is recorded as game 0 of the seed
+    GameRecorder recorder;
+
+    recorder.masterSeed = masterSeed;
+
+    // start the game. a game that could not be played has no record
+    bool isPlayed = play(context, gameMode, config, rng, recordFile.empty() ? nullptr : &recorder, input, renderer);
+
+    if (!recordFile.empty()) {
+        if (isPlayed) {
+            writeGameRecord(writer, recorder);
+        }
+
+        closeGameRecordWriter(writer);
+    }
 
-    // start the game
-    play(player1, player2, gameMode);
-    return 0;
+    closeRenderer(renderer);
+    closeInput(input);
+    return isPlayed ? 0 : 1;
 }
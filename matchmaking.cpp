@@ -0,0 +1,216 @@
+#include "header.h"
+
+// function sets 'queue' up empty with room for at least 'capacity' tickets,
+// rounded up to a power of two
+void openMatchQueue(MatchQueue& queue, int capacity) {
+    uint64_t numCells = 2;
+
+    while (numCells < (uint64_t)capacity) {
+        numCells *= 2;
+    }
+
+    queue.cells.reset(new MatchQueueCell[numCells]);
+    queue.mask = numCells - 1;
+
+    // a slot is free for the push at the position it starts with
+    for (uint64_t cell = 0; cell < numCells; cell++) {
+        queue.cells[cell].sequence.store(cell, memory_order_relaxed);
+    }
+
+    queue.pushPosition.store(0, memory_order_relaxed);
+    queue.popPosition.store(0, memory_order_relaxed);
+}
+
+// function adds 'ticket' to the back of 'queue'. safe to call from any
+// number of threads at once. returns false if the queue is full
+bool pushMatchTicket(MatchQueue& queue, const MatchTicket& ticket) {
+    uint64_t position = queue.pushPosition.load(memory_order_relaxed);
+
+    while (true) {
+        MatchQueueCell& cell = queue.cells[position & queue.mask];
+        const int64_t lag = (int64_t)(cell.sequence.load(memory_order_acquire) - position);
+
+        if (lag == 0) {
+            // the slot is free, and is this push's if no other push claims
+            // the position first
+            if (queue.pushPosition.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                cell.ticket = ticket;
+                cell.sequence.store(position + 1, memory_order_release);
+                return true;
+            }
+        } else if (lag < 0) {
+            // the slot still holds the ticket pushed a lap ago
+            return false;
+        } else {
+            position = queue.pushPosition.load(memory_order_relaxed);
+        }
+    }
+}
+
+// function takes the ticket at the front of 'queue' into 'ticket'. safe to
+// call from any number of threads at once. returns false if the queue is
+// empty
+bool popMatchTicket(MatchQueue& queue, MatchTicket& ticket) {
+    uint64_t position = queue.popPosition.load(memory_order_relaxed);
+
+    while (true) {
+        MatchQueueCell& cell = queue.cells[position & queue.mask];
+        const int64_t lag = (int64_t)(cell.sequence.load(memory_order_acquire) - (position + 1));
+
+        if (lag == 0) {
+            if (queue.popPosition.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                ticket = cell.ticket;
+
+                // frees the slot for the push a lap later
+                cell.sequence.store(position + queue.mask + 1, memory_order_release);
+                return true;
+            }
+        } else if (lag < 0) {
+            // the slot has not been pushed to yet
+            return false;
+        } else {
+            position = queue.popPosition.load(memory_order_relaxed);
+        }
+    }
+}
+
+// function returns how many tickets are in 'queue'. with other threads
+// pushing and popping it is only a snapshot
+uint64_t matchQueueDepth(const MatchQueue& queue) {
+    const uint64_t popPosition = queue.popPosition.load(memory_order_relaxed);
+    const uint64_t pushPosition = queue.pushPosition.load(memory_order_relaxed);
+
+    return (pushPosition > popPosition) ? pushPosition - popPosition : 0;
+}
+
+// function sets 'matchmaker' up with room for 'capacity' queued tickets and
+// starts its clock
+void openMatchmaker(Matchmaker& matchmaker, int capacity) {
+    openMatchQueue(matchmaker.queue, capacity);
+
+    matchmaker.waiting.store(NO_WAITING_TICKET, memory_order_relaxed);
+    matchmaker.maxDepth.store(0, memory_order_relaxed);
+    matchmaker.openedAt = chrono::steady_clock::now();
+}
+
+// function returns the time on the clock of 'matchmaker', in microseconds
+uint32_t matchmakerClock(const Matchmaker& matchmaker) {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - matchmaker.openedAt).count();
+}
+
+// function packs 'player' and 'queuedAt' of a ticket into one word
+uint64_t packMatchTicket(uint32_t player, uint32_t queuedAt) {
+    return ((uint64_t)player << 32) | queuedAt;
+}
+
+// function queues a ticket for 'player' to play a game of 'gameMode' and
+// sets 'queuedAt' to its time. safe to call from any number of threads at
+// once. returns false if the queue is full
+bool queueMatchTicket(Matchmaker& matchmaker, uint32_t player, int gameMode, uint32_t& queuedAt) {
+    MatchTicket ticket;
+
+    ticket.player = player;
+    ticket.queuedAt = matchmakerClock(matchmaker);
+    ticket.gameMode = gameMode;
+
+    if (!pushMatchTicket(matchmaker.queue, ticket)) {
+        return false;
+    }
+
+    queuedAt = ticket.queuedAt;
+
+    // the deepest the queue has been only has to be written when it grows
+    const uint64_t depth = matchQueueDepth(matchmaker.queue);
+    uint64_t maxDepth = matchmaker.maxDepth.load(memory_order_relaxed);
+
+    while (depth > maxDepth && !matchmaker.maxDepth.compare_exchange_weak(maxDepth, depth, memory_order_relaxed)) {
+    }
+
+    return true;
+}
+
+// function takes the ticket of 'player' queued at 'queuedAt' back if it is
+// the one waiting for an opponent. returns false if it is not, the ticket
+// may still be queued then and the caller has to skip it once it is paired
+bool cancelMatchTicket(Matchmaker& matchmaker, uint32_t player, uint32_t queuedAt) {
+    uint64_t waiting = packMatchTicket(player, queuedAt);
+
+    return matchmaker.waiting.compare_exchange_strong(waiting, NO_WAITING_TICKET, memory_order_acq_rel);
+}
+
+// function records how long 'ticket' waited until 'now'
+void recordPairingLatency(MatchmakingStats& stats, const MatchTicket& ticket, uint32_t now) {
+    // the difference is right across a wrap of the clock too
+    const uint32_t waited = now - ticket.queuedAt;
+
+    recordLatency(stats.pairingLatency, (uint64_t)waited * 1000);
+}
+
+// function takes up to 'maxTickets' tickets off the queue of 'matchmaker'
+// and pairs them. 'startMatch' is called with both tickets of a player vs
+// player game, the one that waited first being player 1, and with 'second'
+// null for a game against the computer. safe to call from any number of
+// threads at once, each with 'stats' of its own. returns how many tickets
+// were taken
+int pairMatchTickets(Matchmaker& matchmaker, MatchmakingStats& stats, int maxTickets, const function<void(const MatchTicket& first, const MatchTicket* second)>& startMatch) {
+    MatchTicket ticket;
+    int numTickets = 0;
+
+    while (numTickets < maxTickets && popMatchTicket(matchmaker.queue, ticket)) {
+        numTickets++;
+
+        if (ticket.gameMode != 1) {
+            recordPairingLatency(stats, ticket, matchmakerClock(matchmaker));
+            stats.numComputerMatches++;
+
+            startMatch(ticket, nullptr);
+            continue;
+        }
+
+        // either takes the ticket that is waiting or leaves this one
+        // waiting, whichever compare-and-swap gets there first
+        uint64_t waiting = matchmaker.waiting.load(memory_order_acquire);
+        bool isWaiting = false;
+
+        while (true) {
+            if (waiting == NO_WAITING_TICKET) {
+                if (matchmaker.waiting.compare_exchange_weak(waiting, packMatchTicket(ticket.player, ticket.queuedAt), memory_order_acq_rel)) {
+                    isWaiting = true;
+                    break;
+                }
+            } else if (matchmaker.waiting.compare_exchange_weak(waiting, NO_WAITING_TICKET, memory_order_acq_rel)) {
+                break;
+            }
+        }
+
+        if (isWaiting) {
+            continue;
+        }
+
+        MatchTicket opponent;
+
+        opponent.player = waiting >> 32;
+        opponent.queuedAt = (uint32_t)waiting;
+        opponent.gameMode = 1;
+
+        // the clock is read once the pair is made, the waiting ticket may
+        // have been queued after this one was taken off the queue
+        const uint32_t now = matchmakerClock(matchmaker);
+
+        recordPairingLatency(stats, opponent, now);
+        recordPairingLatency(stats, ticket, now);
+        stats.numPlayerMatches++;
+
+        startMatch(opponent, &ticket);
+    }
+
+    return numTickets;
+}
+
+// function adds the stats in 'other' into 'stats'
+void mergeMatchmakingStats(MatchmakingStats& stats, const MatchmakingStats& other) {
+    stats.numPlayerMatches += other.numPlayerMatches;
+    stats.numComputerMatches += other.numComputerMatches;
+
+    mergeLatencyHistogram(stats.pairingLatency, other.pairingLatency);
+}
@@ -0,0 +1,390 @@
+#include "header.h"
+
+// the samples of a shot are drawn in blocks of this many fleets, each from
+// a generator of its own
+const int SAMPLES_PER_BLOCK = 64;
+
+// what the computer knows about the board it is firing at. 'board' is the
+// opponent's board, but only its hit and miss marks are looked at
+struct SamplerView {
+    const Board* board;
+    const Grid<char>* sunkCells;
+    const vector<Point>* hits;
+    const PlacementIndex* placementIndex;
+    int numRows;
+    int numCols;
+};
+
+// function checks if a ship can lie at 'placement' in the fleet being
+// sampled. the ship can not leave the board, cover a miss, a sunken ship or
+// a ship placed earlier, and it can not cover only hits since it would
+// have sunk
+bool canPlace(const SamplerView& view, const SamplerScratch& scratch, const Placement& placement) {
+    const bool isVertical = (placement.orientation == 'V');
+
+    if (placement.rowIndex < 0 || placement.colIndex < 0 ||
+        (isVertical ? placement.rowIndex + placement.shipSize > view.numRows : placement.rowIndex >= view.numRows) ||
+        (isVertical ? placement.colIndex >= view.numCols : placement.colIndex + placement.shipSize > view.numCols)) {
+        return false;
+    }
+
+    const int step = isVertical ? view.numCols : 1;
+
+    int cell = placement.rowIndex * view.numCols + placement.colIndex;
+    int numHits = 0;
+
+    for (int offset = 0; offset < placement.shipSize; offset++, cell += step) {
+        char loc = view.board->cells[cell];
+
+        if (loc == 'O' || view.sunkCells->cells[cell] || scratch.isOccupied[cell]) {
+            return false;
+        }
+
+        numHits += (loc == 'X');
+    }
+
+    return numHits < placement.shipSize;
+}
+
+// function puts the ship 'unplacedShips[unplacedIndex]' at 'placement'
+void placeSampledShip(const SamplerView& view, SamplerScratch& scratch, int unplacedIndex, const Placement& placement) {
+    const int step = (placement.orientation == 'V') ? view.numCols : 1;
+
+    int cell = placement.rowIndex * view.numCols + placement.colIndex;
+
+    for (int offset = 0; offset < placement.shipSize; offset++, cell += step) {
+        scratch.isOccupied[cell] = true;
+        scratch.placedCells.push_back(cell);
+    }
+
+    scratch.unplacedShips[unplacedIndex] = scratch.unplacedShips.back();
+    scratch.unplacedShips.pop_back();
+}
+
+// function samples one fleet that agrees with everything the computer has
+// seen. the hits that do not belong to a sunken ship are covered first: the
+// first uncovered hit gets a ship through it, picked at random from every
+// way an unplaced ship can cover it. the other ships then go anywhere they
+// fit, which the placement index already knows for every placement that
+// avoids the shots. returns false if the sample ran into a dead end
+bool sampleFleet(const SamplerView& view, SamplerScratch& scratch) {
+    const int maxTries = 100;
+    const char orientations[2] = {'H', 'V'};
+
+    scratch.unplacedShips.clear();
+
+    for (int shipIndex = 0; shipIndex < (int)scratch.shipSizes.size(); shipIndex++) {
+        scratch.unplacedShips.push_back(shipIndex);
+    }
+
+    for (const Point& hit : *view.hits) {
+        const int hitCell = hit.rowIndex * view.numCols + hit.colIndex;
+
+        if (scratch.isOccupied[hitCell]) {
+            continue;
+        }
+
+        scratch.candidates.clear();
+        scratch.candidateShips.clear();
+
+        for (int unplacedIndex = 0; unplacedIndex < (int)scratch.unplacedShips.size(); unplacedIndex++) {
+            const int shipSize = scratch.shipSizes[scratch.unplacedShips[unplacedIndex]];
+
+            for (char orientation : orientations) {
+                for (int offset = 0; offset < shipSize; offset++) {
+                    Placement placement = {shipSize, hit.rowIndex, hit.colIndex, orientation};
+
+                    if (orientation == 'V') {
+                        placement.rowIndex -= offset;
+                    } else {
+                        placement.colIndex -= offset;
+                    }
+
+                    if (canPlace(view, scratch, placement)) {
+                        scratch.candidates.push_back(placement);
+                        scratch.candidateShips.push_back(unplacedIndex);
+                    }
+                }
+            }
+        }
+
+        if (scratch.candidates.empty()) {
+            return false;
+        }
+
+        int choice = randomBelow(scratch.rng, scratch.candidates.size());
+
+        placeSampledShip(view, scratch, scratch.candidateShips[choice], scratch.candidates[choice]);
+    }
+
+    // every hit is covered now, so the other ships only go on cells that
+    // have not been shot. those are the placements the placement index
+    // still has, so a random placement only has to be live and clear of the
+    // ships placed so far
+    const PlacementIndex& index = *view.placementIndex;
+    const PlacementTable& table = *index.table;
+
+    while (!scratch.unplacedShips.empty()) {
+        const int sizeIndex = scratch.sizeIndices[scratch.unplacedShips.back()];
+        const int firstPlacement = table.firstPlacement[sizeIndex];
+        const int numPlacements = table.firstPlacement[sizeIndex + 1] - firstPlacement;
+
+        bool isPlaced = false;
+
+        for (int tries = 0; tries < maxTries && !isPlaced && index.numLivePlacements[sizeIndex] > 0; tries++) {
+            int placementNumber = firstPlacement + randomBelow(scratch.rng, numPlacements);
+
+            if (!index.isLive[placementNumber]) {
+                continue;
+            }
+
+            const Placement placement = getPlacement(table, sizeIndex, placementNumber);
+            const int step = (placement.orientation == 'V') ? view.numCols : 1;
+
+            int cell = placement.rowIndex * view.numCols + placement.colIndex;
+            bool isClear = true;
+
+            for (int offset = 0; offset < placement.shipSize && isClear; offset++, cell += step) {
+                isClear = !scratch.isOccupied[cell];
+            }
+
+            if (isClear) {
+                placeSampledShip(view, scratch, scratch.unplacedShips.size() - 1, placement);
+                isPlaced = true;
+            }
+        }
+
+        if (!isPlaced) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// function keeps sampling fleets into 'scratch' until it has 'maxSamples'
+// of them or 'deadline' has passed. every cell that has not been shot gets
+// one count for every sampled fleet that covers it
+void runSampler(const SamplerView& view, SamplerScratch& scratch, int maxSamples, bool hasDeadline, chrono::steady_clock::time_point deadline) {
+    // the clock is only looked at every few samples
+    const int samplesPerClockCheck = 16;
+
+    scratch.numSamples = 0;
+
+    for (int attempt = 0; scratch.numSamples < maxSamples; attempt++) {
+        if (hasDeadline && attempt % samplesPerClockCheck == 0 && chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+
+        // a budget of failed attempts keeps a board where fleets are hard
+        // to fit from spinning until the deadline
+        if (attempt >= 4 * maxSamples && scratch.numSamples == 0) {
+            break;
+        }
+
+        if (sampleFleet(view, scratch)) {
+            scratch.numSamples++;
+
+            for (int cell : scratch.placedCells) {
+                if (view.board->cells[cell] == 'X') {
+                    continue;
+                }
+
+                if (scratch.occupancy[cell]++ == 0) {
+                    scratch.countedCells.push_back(cell);
+                }
+            }
+        }
+
+        for (int cell : scratch.placedCells) {
+            scratch.isOccupied[cell] = false;
+        }
+
+        scratch.placedCells.clear();
+    }
+}
+
+// function samples the blocks of 'budget' that belong to 'worker' into
+// 'scratch', adding up their counts
+void runSamplerBlocks(const SamplerView& view, SamplerScratch& scratch, const SampleBudget& budget, int worker) {
+    const int numBlocks = (budget.maxSamples + SAMPLES_PER_BLOCK - 1) / SAMPLES_PER_BLOCK;
+
+    for (int block = worker; block < numBlocks; block += budget.numWorkers) {
+        scratch.rng = makeGameRng(budget.seed, block);
+
+        runSampler(view, scratch, min(SAMPLES_PER_BLOCK, budget.maxSamples - block * SAMPLES_PER_BLOCK), budget.hasDeadline, budget.deadline);
+    }
+}
+
+// function samples the shots handed to 'pool' in 'pool.samplers[worker]' on
+// a thread of the pool, until the pool stops
+void runSamplerWorker(SamplerPool& pool, int worker) {
+    long long round = 0;
+
+    while (true) {
+        {
+            unique_lock<mutex> guard(pool.lock);
+
+            pool.wake.wait(guard, [&]() {
+                return pool.isStopping || pool.round != round;
+            });
+
+            if (pool.isStopping) {
+                return;
+            }
+
+            round = pool.round;
+        }
+
+        runSamplerBlocks(*pool.view, pool.samplers[worker], pool.budget, worker);
+
+        lock_guard<mutex> guard(pool.lock);
+
+        if (--pool.numBusy == 0) {
+            pool.finished.notify_one();
+        }
+    }
+}
+
+// function starts 'numThreads' sampler threads in 'pool'
+void startSamplerPool(SamplerPool& pool, int numThreads) {
+    for (int thread = 0; thread < numThreads; thread++) {
+        pool.threads.emplace_back(runSamplerWorker, ref(pool), thread + 1);
+    }
+}
+
+// stops the threads of the pool once they are done with their shot
+SamplerPool::~SamplerPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        isStopping = true;
+    }
+
+    wake.notify_all();
+
+    for (thread& samplerThread : threads) {
+        samplerThread.join();
+    }
+}
+
+// function samples 'view' into 'samplers' on this thread and every thread of
+// 'pool' at once, and returns once they are all done
+void runSamplerRound(SamplerPool& pool, const SamplerView& view, vector<SamplerScratch>& samplers, const SampleBudget& budget) {
+    {
+        lock_guard<mutex> guard(pool.lock);
+
+        pool.view = &view;
+        pool.samplers = samplers.data();
+        pool.budget = budget;
+        pool.numBusy = pool.threads.size();
+        pool.round++;
+    }
+
+    pool.wake.notify_all();
+
+    runSamplerBlocks(view, samplers[0], budget, 0);
+
+    unique_lock<mutex> guard(pool.lock);
+
+    pool.finished.wait(guard, [&]() {
+        return pool.numBusy == 0;
+    });
+}
+
+// function picks the computer's next target shot by sampling whole fleets
+// that agree with the hits, the misses and the sunken ships, and shooting at
+// the cell that the most of them cover. ties are broken at random. returns
+// false if no fleet could be sampled, in which case the computer falls back
+// on its heuristic
+bool sampleTargetShot(const Player& opponent, int fleetSize, ComputerState& computer, Point& targetShot, GameRng& rng) {
+    const MonteCarloSettings& settings = computer.monteCarlo;
+    const int numCells = opponent.board.numRows * opponent.board.numCols;
+    const int numWorkers = max(1, settings.numThreads);
+
+    const SamplerView view = {&opponent.board, &computer.sunkCells, &computer.hits, &computer.placementIndex, opponent.board.numRows, opponent.board.numCols};
+    const vector<int>& tableSizes = computer.placementIndex.table->shipSizes;
+
+    // sets up every worker's scratch space. the generators of the blocks
+    // are made from one number drawn for the shot
+    computer.samplers.resize(numWorkers);
+
+    for (SamplerScratch& scratch : computer.samplers) {
+        if ((int)scratch.occupancy.size() != numCells) {
+            scratch.occupancy.assign(numCells, 0);
+            scratch.isOccupied.assign(numCells, false);
+            scratch.countedCells.reserve(numCells);
+            scratch.placedCells.reserve(numCells);
+        }
+
+        scratch.shipSizes.clear();
+        scratch.sizeIndices.clear();
+
+        for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
+            const int shipSize = opponent.fleet[shipIndex].size;
+
+            scratch.shipSizes.push_back(shipSize);
+            scratch.sizeIndices.push_back(find(tableSizes.begin(), tableSizes.end(), shipSize) - tableSizes.begin());
+        }
+    }
+
+    const SampleBudget budget = {rng(), settings.maxSamples, numWorkers, settings.timeBudgetMs > 0,
+                                 chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(settings.timeBudgetMs))};
+
+    // a single worker samples on this thread. more workers sample on this
+    // thread and the computer's sampler threads, which are only started
+    // once, or again if the number of threads changed
+    if (numWorkers == 1) {
+        runSamplerBlocks(view, computer.samplers[0], budget, 0);
+    } else {
+        unique_ptr<SamplerPool>& pool = computer.samplerThreads.pool;
+
+        if (pool == nullptr || (int)pool->threads.size() != numWorkers - 1) {
+            pool.reset(new SamplerPool());
+            startSamplerPool(*pool, numWorkers - 1);
+        }
+
+        runSamplerRound(*pool, view, computer.samplers, budget);
+    }
+
+    // adds every worker's counts into the first worker's
+    SamplerScratch& total = computer.samplers[0];
+
+    for (int worker = 1; worker < numWorkers; worker++) {
+        SamplerScratch& scratch = computer.samplers[worker];
+
+        for (int cell : scratch.countedCells) {
+            if (total.occupancy[cell] == 0) {
+                total.countedCells.push_back(cell);
+            }
+
+            total.occupancy[cell] += scratch.occupancy[cell];
+            scratch.occupancy[cell] = 0;
+        }
+
+        scratch.countedCells.clear();
+    }
+
+    // picks the cell with the highest count and clears the counts for the
+    // next shot. the cells are gone through in order, since the order they
+    // were first counted in depends on which worker sampled what
+    sort(total.countedCells.begin(), total.countedCells.end());
+
+    int highestOccupancy = 0;
+    int numTies = 0;
+
+    for (int cell : total.countedCells) {
+        if (total.occupancy[cell] > highestOccupancy) {
+            highestOccupancy = total.occupancy[cell];
+            numTies = 1;
+            targetShot = {cell / view.numCols, cell % view.numCols};
+        } else if (total.occupancy[cell] == highestOccupancy && randomBelow(rng, ++numTies) == 0) {
+            targetShot = {cell / view.numCols, cell % view.numCols};
+        }
+
+        total.occupancy[cell] = 0;
+    }
+
+    total.countedCells.clear();
+
+    return numTies > 0;
+}
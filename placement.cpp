@@ -0,0 +1,317 @@
+#include "header.h"
+
+#include <map>
+
+// function numbers the placements of every ship size on a 'numRows' by
+// 'numCols' board. a ship that is longer than the board in one direction
+// simply has no placements in that orientation
+PlacementTable buildPlacementTable(int numRows, int numCols, const vector<int>& shipSizes) {
+    PlacementTable table;
+
+    table.numRows = numRows;
+    table.numCols = numCols;
+    table.shipSizes = shipSizes;
+
+    int numPlacements = 0;
+
+    for (int shipSize : shipSizes) {
+        int numHorizontal = (shipSize <= numCols) ? numRows * (numCols - shipSize + 1) : 0;
+        int numVertical = (shipSize <= numRows) ? (numRows - shipSize + 1) * numCols : 0;
+
+        table.firstPlacement.push_back(numPlacements);
+        table.numHorizontal.push_back(numHorizontal);
+
+        numPlacements += numHorizontal + numVertical;
+    }
+
+    table.firstPlacement.push_back(numPlacements);
+
+    return table;
+}
+
+// function returns the placement table for the board size and the ship sizes
+// in 'fleet'. a table is built the first time a board size and fleet are
+// seen and shared by every game afterwards
+const PlacementTable& getPlacementTable(int numRows, int numCols, const vector<Ship>& fleet, int fleetSize) {
+    static mutex tablesLock;
+    static map<vector<int>, PlacementTable> tables;
+
+    vector<int> shipSizes;
+
+    for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
+        if (find(shipSizes.begin(), shipSizes.end(), fleet[shipIndex].size) == shipSizes.end()) {
+            shipSizes.push_back(fleet[shipIndex].size);
+        }
+    }
+
+    sort(shipSizes.begin(), shipSizes.end());
+
+    // the key is the board size followed by the ship sizes
+    vector<int> key = {numRows, numCols};
+    key.insert(key.end(), shipSizes.begin(), shipSizes.end());
+
+    lock_guard<mutex> guard(tablesLock);
+
+    auto found = tables.find(key);
+
+    if (found == tables.end()) {
+        found = tables.emplace(key, buildPlacementTable(numRows, numCols, shipSizes)).first;
+    }
+
+    return found->second;
+}
+
+// function works out the placement with number 'placement', which has to be
+// one of the placements of 'shipSizes[sizeIndex]'
+Placement getPlacement(const PlacementTable& table, int sizeIndex, int placement) {
+    const int shipSize = table.shipSizes[sizeIndex];
+    int offset = placement - table.firstPlacement[sizeIndex];
+
+    Placement result;
+    result.shipSize = shipSize;
+
+    if (offset < table.numHorizontal[sizeIndex]) {
+        int numStarts = table.numCols - shipSize + 1;
+
+        result.orientation = 'H';
+        result.rowIndex = offset / numStarts;
+        result.colIndex = offset % numStarts;
+    } else {
+        offset -= table.numHorizontal[sizeIndex];
+
+        result.orientation = 'V';
+        result.rowIndex = offset / table.numCols;
+        result.colIndex = offset % table.numCols;
+    }
+
+    return result;
+}
+
+// function moves 'cell' from 'bucket' down 'amount' buckets. a cell drops
+// one bucket by swapping places with the first cell of its bucket, which
+// then starts one place later, so moving never needs any memory
+void moveCellDown(PlacementIndex& index, int cell, int bucket, int amount) {
+    for (; amount > 0; amount--, bucket--) {
+        int position = index.orderPosition[cell];
+        int first = index.bucketStart[bucket];
+        int firstCell = index.cellOrder[first];
+
+        index.cellOrder[position] = firstCell;
+        index.orderPosition[firstCell] = position;
+        index.cellOrder[first] = cell;
+        index.orderPosition[cell] = first;
+
+        index.bucketStart[bucket]++;
+    }
+}
+
+// function lowers the density of every cell a placement covers by 'amount'
+// and moves the cells to the matching buckets. cells that have been shot
+// stay in the bucket of the shot cells
+void lowerPlacementDensity(PlacementIndex& index, const Placement& placement, int amount) {
+    const int numCols = index.table->numCols;
+    const int step = (placement.orientation == 'V') ? numCols : 1;
+
+    int cell = placement.rowIndex * numCols + placement.colIndex;
+
+    for (int offset = 0; offset < placement.shipSize; offset++, cell += step) {
+        if (!index.isShot[cell]) {
+            moveCellDown(index, cell, index.cellDensity[cell] + 1, amount);
+        }
+
+        index.cellDensity[cell] -= amount;
+    }
+}
+
+// function drops a live placement, taking its weight off every cell it covers
+void removePlacement(PlacementIndex& index, int sizeIndex, int placement) {
+    const int weight = index.numShips[sizeIndex] * index.table->shipSizes[sizeIndex];
+
+    index.isLive[placement] = false;
+    index.numLivePlacements[sizeIndex]--;
+
+    if (weight != 0) {
+        lowerPlacementDensity(index, getPlacement(*index.table, sizeIndex, placement), weight);
+    }
+}
+
+// function returns how many of the placements of a ship of 'shipSize' along
+// a line of 'lineLength' cells cover the cell at 'position'
+int countCoveringStarts(int position, int shipSize, int lineLength) {
+    if (shipSize > lineLength) {
+        return 0;
+    }
+
+    int firstStart = max(0, position - shipSize + 1);
+    int lastStart = min(position, lineLength - shipSize);
+
+    return max(0, lastStart - firstStart + 1);
+}
+
+// function sets up a computer's placement index for the fleet it is hunting.
+// every placement starts out possible, each one adding the size of its ship
+// to the cells it covers once for every ship of that size. the cells are
+// then sorted into buckets by density
+void initPlacementIndex(PlacementIndex& index, int numRows, int numCols, const vector<Ship>& fleet, int fleetSize) {
+    const int numCells = numRows * numCols;
+
+    index.table = &getPlacementTable(numRows, numCols, fleet, fleetSize);
+
+    const PlacementTable& table = *index.table;
+    const int numSizes = table.shipSizes.size();
+
+    index.numShips.assign(numSizes, 0);
+    index.numLivePlacements.assign(numSizes, 0);
+    index.isLive.assign(table.firstPlacement.back(), true);
+    index.cellDensity.assign(numCells, 0);
+    index.isShot.assign(numCells, false);
+
+    for (int sizeIndex = 0; sizeIndex < numSizes; sizeIndex++) {
+        const int shipSize = table.shipSizes[sizeIndex];
+
+        for (int shipIndex = 0; shipIndex < fleetSize; shipIndex++) {
+            if (fleet[shipIndex].size == shipSize) {
+                index.numShips[sizeIndex]++;
+            }
+        }
+
+        index.numLivePlacements[sizeIndex] = table.firstPlacement[sizeIndex + 1] - table.firstPlacement[sizeIndex];
+
+        // the number of placements covering a cell follows from how close
+        // the cell is to the edges of the board
+        const int weight = index.numShips[sizeIndex] * shipSize;
+
+        for (int row = 0; row < numRows; row++) {
+            for (int col = 0; col < numCols; col++) {
+                int numCovering = countCoveringStarts(col, shipSize, numCols) + countCoveringStarts(row, shipSize, numRows);
+
+                index.cellDensity[row * numCols + col] += numCovering * weight;
+            }
+        }
+    }
+
+    // sorts the cells into their buckets by counting how many cells each
+    // bucket gets first
+    index.highestDensity = *max_element(index.cellDensity.begin(), index.cellDensity.end());
+    index.bucketStart.assign(index.highestDensity + 3, 0);
+    index.cellOrder.assign(numCells, 0);
+    index.orderPosition.assign(numCells, 0);
+
+    for (int cell = 0; cell < numCells; cell++) {
+        index.bucketStart[index.cellDensity[cell] + 2]++;
+    }
+
+    for (int bucket = 1; bucket < (int)index.bucketStart.size(); bucket++) {
+        index.bucketStart[bucket] += index.bucketStart[bucket - 1];
+    }
+
+    for (int cell = 0; cell < numCells; cell++) {
+        int position = index.bucketStart[index.cellDensity[cell] + 1]++;
+
+        index.cellOrder[position] = cell;
+        index.orderPosition[cell] = position;
+    }
+
+    // placing the cells moved every bucket's start to the start of the
+    // bucket above it, so they are moved back
+    for (int bucket = (int)index.bucketStart.size() - 1; bucket > 0; bucket--) {
+        index.bucketStart[bucket] = index.bucketStart[bucket - 1];
+    }
+
+    index.bucketStart[0] = 0;
+}
+
+// function records a shot at 'rowIndex', 'colIndex'. only the placements
+// covering that cell are touched: each one is dropped and its weight taken
+// off the cells it covered. the shot cell itself moves to the bucket of
+// the shot cells
+void recordShot(PlacementIndex& index, int rowIndex, int colIndex) {
+    const PlacementTable& table = *index.table;
+    const int cell = rowIndex * table.numCols + colIndex;
+
+    if (index.isShot[cell]) {
+        return;
+    }
+
+    moveCellDown(index, cell, index.cellDensity[cell] + 1, index.cellDensity[cell] + 1);
+    index.isShot[cell] = true;
+
+    for (int sizeIndex = 0; sizeIndex < (int)table.shipSizes.size(); sizeIndex++) {
+        const int shipSize = table.shipSizes[sizeIndex];
+        const int firstPlacement = table.firstPlacement[sizeIndex];
+
+        // horizontal placements in the same row that start at most
+        // 'shipSize - 1' cells to the left
+        if (shipSize <= table.numCols) {
+            int numStarts = table.numCols - shipSize + 1;
+
+            for (int startCol = max(0, colIndex - shipSize + 1); startCol <= min(colIndex, numStarts - 1); startCol++) {
+                int placement = firstPlacement + rowIndex * numStarts + startCol;
+
+                if (index.isLive[placement]) {
+                    removePlacement(index, sizeIndex, placement);
+                }
+            }
+        }
+
+        // vertical placements in the same column that start at most
+        // 'shipSize - 1' cells above
+        if (shipSize <= table.numRows) {
+            int numStarts = table.numRows - shipSize + 1;
+
+            for (int startRow = max(0, rowIndex - shipSize + 1); startRow <= min(rowIndex, numStarts - 1); startRow++) {
+                int placement = firstPlacement + table.numHorizontal[sizeIndex] + startRow * table.numCols + colIndex;
+
+                if (index.isLive[placement]) {
+                    removePlacement(index, sizeIndex, placement);
+                }
+            }
+        }
+    }
+}
+
+// function records that a ship of 'shipSize' has sunk. the live placements of
+// that size now count for one ship less, so their weight is lowered
+void recordSunkShip(PlacementIndex& index, int shipSize) {
+    const PlacementTable& table = *index.table;
+
+    int sizeIndex = find(table.shipSizes.begin(), table.shipSizes.end(), shipSize) - table.shipSizes.begin();
+
+    if (sizeIndex == (int)table.shipSizes.size() || index.numShips[sizeIndex] == 0) {
+        return;
+    }
+
+    index.numShips[sizeIndex]--;
+
+    for (int placement = table.firstPlacement[sizeIndex]; placement < table.firstPlacement[sizeIndex + 1]; placement++) {
+        if (index.isLive[placement]) {
+            lowerPlacementDensity(index, getPlacement(table, sizeIndex, placement), shipSize);
+        }
+    }
+}
+
+// function picks a random cell among the cells that have not been shot and
+// share the highest density. densities only ever go down, so the search for
+// the highest non-empty bucket picks up where it last stopped. returns false
+// if every cell has been shot
+bool pickHighestDensityCell(PlacementIndex& index, int& rowIndex, int& colIndex, GameRng& rng) {
+    const vector<int>& bucketStart = index.bucketStart;
+
+    while (index.highestDensity > 0 && bucketStart[index.highestDensity + 1] == bucketStart[index.highestDensity + 2]) {
+        index.highestDensity--;
+    }
+
+    const int first = bucketStart[index.highestDensity + 1];
+    const int last = bucketStart[index.highestDensity + 2];
+
+    if (first == last) {
+        return false;
+    }
+
+    int cell = index.cellOrder[first + randomBelow(rng, last - first)];
+
+    rowIndex = cell / index.table->numCols;
+    colIndex = cell % index.table->numCols;
+
+    return true;
+}
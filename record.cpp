@@ -0,0 +1,378 @@
+#include "header.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// the start of every record file. the version goes up whenever the games a
+// seed plays change, version 2 came with the computers drawing their fleets
+// from the legal placements and version 3 with the Monte Carlo engine
+// sampling in fixed blocks
+const char RECORD_MAGIC[4] = {'B', 'S', 'G', 'R'};
+const uint8_t RECORD_VERSION = 3;
+
+// the writer hands its buffer to the file once it holds this many bytes
+const size_t RECORD_FLUSH_BYTES = 1 << 20;
+
+// function appends 'value' to 'bytes' as a LEB128 varint: seven bits per
+// byte, lowest first, with the top bit set on every byte but the last
+void writeVarint(vector<uint8_t>& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+
+    bytes.push_back(uint8_t(value));
+}
+
+// function reads a varint. returns false and marks the reader as corrupt if
+// the data ends in the middle of one or it is longer than 64 bits
+bool readVarint(RecordReader& reader, uint64_t& value) {
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader.next == reader.end) {
+            break;
+        }
+
+        uint8_t byte = *reader.next++;
+
+        value |= uint64_t(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    reader.isCorrupt = true;
+    return false;
+}
+
+// function reads a varint that has to be at most 'maxValue'
+bool readBoundedVarint(RecordReader& reader, uint64_t maxValue, int& value) {
+    uint64_t raw;
+
+    if (!readVarint(reader, raw) || raw > maxValue) {
+        reader.isCorrupt = true;
+        return false;
+    }
+
+    value = raw;
+    return true;
+}
+
+// function writes the placements of the fleet of 'player', in the order of
+// the ships file. nothing has sunk yet, so that is the order of the fleet
+void writePlacements(vector<uint8_t>& bytes, const Player& player) {
+    for (const Ship& ship : player.fleet) {
+        const Point& start = ship.points.front();
+        const bool isVertical = ship.points.size() > 1 && ship.points[1].colIndex == start.colIndex;
+
+        writeVarint(bytes, ship.size);
+        writeVarint(bytes, (start.rowIndex * player.board.numCols + start.colIndex) * 2 + isVertical);
+    }
+}
+
+// function starts the record of a game once both fleets are placed
+void startGameRecord(GameRecorder& recorder, const Player& player1, const Player& player2) {
+    vector<uint8_t>& bytes = recorder.bytes;
+
+    bytes.clear();
+
+    writeVarint(bytes, recorder.gameMode);
+    writeVarint(bytes, recorder.masterSeed);
+    writeVarint(bytes, recorder.gameIndex);
+    writeVarint(bytes, player1.board.numRows);
+    writeVarint(bytes, player1.board.numCols);
+    writeVarint(bytes, player1.fleet.size());
+
+    writePlacements(bytes, player1);
+    writePlacements(bytes, player2);
+}
+
+// function returns how the shot just fired at 'target' turned out, and the
+// id of the ship it hit in 'shipId'. 'numShipsBefore' is how many ships
+// 'target' had afloat before the shot, so a sink is told apart from a hit
+// by the fleet getting smaller
+ShotResult classifyShot(const Player& target, int targetNumShips, int numShipsBefore, int rowIndex, int colIndex, int& shipId) {
+    shipId = -1;
+
+    if (targetNumShips < numShipsBefore) {
+        // the ship that just sunk sits right after the ships still afloat
+        shipId = target.fleet[targetNumShips].id;
+        return SHOT_SINK;
+    }
+
+    if (target.board[rowIndex][colIndex] == 'X') {
+        shipId = target.fleet[target.shipIds[rowIndex][colIndex]].id;
+        return SHOT_HIT;
+    }
+
+    return SHOT_MISS;
+}
+
+// function records the shot 'shooter' (0 or 1) just fired at 'target'
+void recordShotEvent(GameRecorder& recorder, int shooter, const Player& target, int targetNumShips, int numShipsBefore, int rowIndex, int colIndex) {
+    const int cell = rowIndex * target.board.numCols + colIndex;
+
+    int shipId;
+    ShotResult result = classifyShot(target, targetNumShips, numShipsBefore, rowIndex, colIndex, shipId);
+
+    writeVarint(recorder.bytes, 1 + ((uint64_t)cell * 8 + result * 2 + shooter));
+
+    if (result != SHOT_MISS) {
+        writeVarint(recorder.bytes, shipId);
+    }
+}
+
+// function ends the record of a game
+void finishGameRecord(GameRecorder& recorder, int winner) {
+    writeVarint(recorder.bytes, 0);
+    writeVarint(recorder.bytes, winner);
+}
+
+// function opens 'path' for writing records. returns false if it can not
+// be opened
+bool openGameRecordWriter(GameRecordWriter& writer, const string& path) {
+    writer.out.open(path, ios::binary | ios::trunc);
+
+    if (!writer.out) {
+        return false;
+    }
+
+    writer.buffer.reserve(RECORD_FLUSH_BYTES + (1 << 16));
+    writer.buffer.assign(RECORD_MAGIC, RECORD_MAGIC + 4);
+    writer.buffer.push_back(RECORD_VERSION);
+    writer.numGames = 0;
+
+    return true;
+}
+
+// function adds a finished game record to the file. any thread can call it
+void writeGameRecord(GameRecordWriter& writer, const GameRecorder& recorder) {
+    lock_guard<mutex> guard(writer.lock);
+
+    writer.buffer.insert(writer.buffer.end(), recorder.bytes.begin(), recorder.bytes.end());
+    writer.numGames++;
+
+    if (writer.buffer.size() >= RECORD_FLUSH_BYTES) {
+        writer.out.write(writer.buffer.data(), writer.buffer.size());
+        writer.buffer.clear();
+    }
+}
+
+// function writes out what is left in the buffer and closes the file
+void closeGameRecordWriter(GameRecordWriter& writer) {
+    lock_guard<mutex> guard(writer.lock);
+
+    writer.out.write(writer.buffer.data(), writer.buffer.size());
+    writer.buffer.clear();
+    writer.out.close();
+}
+
+// function maps the record file 'path' into memory. returns false if it can
+// not be read or does not start like a record file
+bool openGameRecordFile(GameRecordFile& file, const string& path) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat info;
+
+    if (fstat(descriptor, &info) != 0 || info.st_size < 5) {
+        close(descriptor);
+        return false;
+    }
+
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+    // the mapping stays valid after the file is closed
+    close(descriptor);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    // the records are read front to back
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    file.data = (const uint8_t*)data;
+    file.size = info.st_size;
+
+    if (!equal(RECORD_MAGIC, RECORD_MAGIC + 4, (const char*)file.data) || file.data[4] != RECORD_VERSION) {
+        closeGameRecordFile(file);
+        return false;
+    }
+
+    return true;
+}
+
+void closeGameRecordFile(GameRecordFile& file) {
+    if (file.data != nullptr) {
+        munmap((void*)file.data, file.size);
+    }
+
+    file.data = nullptr;
+    file.size = 0;
+}
+
+// function returns a reader at the first record of 'file'
+RecordReader makeRecordReader(const GameRecordFile& file) {
+    RecordReader reader;
+
+    reader.next = file.data + 5;
+    reader.end = file.data + file.size;
+
+    return reader;
+}
+
+// function reads the start of the next record. returns false at the end of
+// the file or if the record is corrupt
+bool readGameHeader(RecordReader& reader, RecordedGame& game) {
+    const int maxBoardSize = 1000;
+
+    if (reader.next == reader.end || reader.isCorrupt) {
+        return false;
+    }
+
+    game.winner = -1;
+
+    if (!readBoundedVarint(reader, 3, game.gameMode) ||
+        !readVarint(reader, game.masterSeed) ||
+        !readVarint(reader, game.gameIndex) ||
+        !readBoundedVarint(reader, maxBoardSize, game.numRows) ||
+        !readBoundedVarint(reader, maxBoardSize, game.numCols) ||
+        !readBoundedVarint(reader, game.numRows * game.numCols, game.numShips)) {
+        return false;
+    }
+
+    // every game is played on a board with at least one cell and a fleet of
+    // at least one ship
+    if (game.numRows < 1 || game.numCols < 1 || game.numShips < 1) {
+        reader.isCorrupt = true;
+        return false;
+    }
+
+    return true;
+}
+
+// function reads placement 'placementIndex' of a record. the ships of player
+// 1 come first, then those of player 2
+bool readPlacement(RecordReader& reader, const RecordedGame& game, int placementIndex, RecordedPlacement& placement) {
+    const int numCells = game.numRows * game.numCols;
+
+    int start;
+
+    if (!readBoundedVarint(reader, max(game.numRows, game.numCols), placement.shipSize) ||
+        !readBoundedVarint(reader, 2 * numCells - 1, start)) {
+        return false;
+    }
+
+    placement.player = placementIndex / game.numShips;
+    placement.shipId = placementIndex % game.numShips;
+    placement.rowIndex = (start / 2) / game.numCols;
+    placement.colIndex = (start / 2) % game.numCols;
+    placement.orientation = (start & 1) ? 'V' : 'H';
+
+    return true;
+}
+
+// function reads the next shot of a record. returns false once the shots
+// are over, after reading the winner into 'game', or if the record is
+// corrupt
+bool readShot(RecordReader& reader, RecordedGame& game, RecordedShot& shot) {
+    const int numCells = game.numRows * game.numCols;
+
+    uint64_t value;
+
+    if (!readVarint(reader, value)) {
+        return false;
+    }
+
+    if (value == 0) {
+        readBoundedVarint(reader, 1, game.winner);
+        return false;
+    }
+
+    value--;
+
+    // the cell is checked before it is narrowed, so a huge varint can not
+    // wrap around into a negative cell
+    const int result = (value / 2) % 4;
+
+    if (value / 8 >= (uint64_t)numCells || result > SHOT_SINK) {
+        reader.isCorrupt = true;
+        return false;
+    }
+
+    const int cell = value / 8;
+
+    shot.shooter = value % 2;
+    shot.rowIndex = cell / game.numCols;
+    shot.colIndex = cell % game.numCols;
+    shot.result = (ShotResult)result;
+    shot.shipId = -1;
+
+    return shot.result == SHOT_MISS || readBoundedVarint(reader, game.numShips - 1, shot.shipId);
+}
+
+// function reads every record in 'path' and prints what is in them. returns
+// false if the file can not be read or a record is corrupt
+bool summarizeGameRecords(const string& path) {
+    GameRecordFile file;
+
+    if (!openGameRecordFile(file, path)) {
+        cout << "Can not read game records from " << path << "\n";
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    RecordReader reader = makeRecordReader(file);
+    RecordedGame game;
+    RecordedPlacement placement;
+    RecordedShot shot;
+
+    long long numGames = 0;
+    long long numShots = 0;
+    long long results[3] = {};
+    long long wins[2] = {};
+
+    while (readGameHeader(reader, game)) {
+        for (int placementIndex = 0; placementIndex < 2 * game.numShips; placementIndex++) {
+            readPlacement(reader, game, placementIndex, placement);
+        }
+
+        while (readShot(reader, game, shot)) {
+            numShots++;
+            results[shot.result]++;
+        }
+
+        if (reader.isCorrupt) {
+            break;
+        }
+
+        numGames++;
+        wins[game.winner]++;
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    cout << "Games: " << numGames << " in " << file.size << " bytes (" << fixed << setprecision(1) << double(file.size) / max(1LL, numGames) << " bytes per game), read in " << setprecision(2) << elapsed.count() << "s\n";
+    cout << "Shots: " << numShots << ", hits: " << results[SHOT_HIT] << ", sinks: " << results[SHOT_SINK] << ", misses: " << results[SHOT_MISS] << "\n";
+    cout << "Wins: player 1 " << wins[0] << ", player 2 " << wins[1] << "\n";
+
+    bool isCorrupt = reader.isCorrupt;
+
+    closeGameRecordFile(file);
+
+    if (isCorrupt) {
+        cout << "The record of game " << numGames + 1 << " is corrupt.\n";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,218 @@
+#include "header.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+// the space between the two boards
+const int BOARD_SPACE = 3;
+
+// function returns how many characters wide a board cell is drawn. the
+// standard board uses three, wider boards grow the cells so the column
+// numbers still fit above them
+int cellWidth(int numCols) {
+    return max(3, int(to_string(numCols).length()) + 2);
+}
+
+// function prints the column header of a board that starts 'boardStart'
+// characters into the line. 'header' holds what has been printed on the
+// line so far
+void printColumnHeader(const Board& board, int boardStart, string& header) {
+    const int labelWidth = rowLabel(board.numRows - 1).length();
+    const int width = cellWidth(board.numCols);
+
+    for (int colIndex = 0; colIndex < board.numCols; colIndex++) {
+        string number = to_string(colIndex + 1);
+
+        // the number ends in the middle of the cell below it
+        int numberEnd = boardStart + labelWidth + 2 + colIndex * (width + 1) + (width - 1) / 2 + (int(number.length()) - 1) / 2;
+
+        header.resize(max(int(header.length()), numberEnd + 1), ' ');
+        header.replace(numberEnd - number.length() + 1, number.length(), number);
+    }
+}
+
+// function returns what a cell of 'board' shows. the ships are hidden once
+// the game has started
+char shownCell(const Board& board, int rowIndex, int colIndex, bool isGameStart) {
+    char loc = board[rowIndex][colIndex];
+
+    if (isGameStart && loc != 'X' && loc != 'O') {
+        loc = ' ';
+    }
+
+    return loc;
+}
+
+// function sets up the parts of the frame that only depend on the size of
+// the boards: the column header, the lines between the rows and the row
+// labels
+void layoutFrame(BoardRenderer& renderer, const Board& board) {
+    const int labelWidth = rowLabel(board.numRows - 1).length();
+    const int boardWidth = board.numCols * (cellWidth(board.numCols) + 1) + 1;
+    const string dashes = string(labelWidth + 1, ' ') + string(boardWidth, '-');
+
+    renderer.numRows = board.numRows;
+    renderer.numCols = board.numCols;
+
+    // the second board starts right after the first one and the space
+    // between them
+    renderer.header.clear();
+    printColumnHeader(board, 0, renderer.header);
+    printColumnHeader(board, labelWidth + 1 + boardWidth + BOARD_SPACE, renderer.header);
+
+    renderer.line = "\n" + dashes + string(BOARD_SPACE, ' ') + dashes + "\n";
+
+    renderer.rowLabels.clear();
+
+    for (int rowIndex = 0; rowIndex < board.numRows; rowIndex++) {
+        string label = rowLabel(rowIndex);
+
+        renderer.rowLabels.push_back(string(labelWidth - label.length(), ' ') + label + " |");
+    }
+
+    renderer.shownCells.assign(2 * board.numRows * board.numCols, ' ');
+    renderer.isPinned = false;
+}
+
+// function adds row 'rowIndex' of 'board' to the frame
+void appendBoardRow(BoardRenderer& renderer, const Board& board, int rowIndex, bool isGameStart) {
+    const int width = cellWidth(board.numCols);
+
+    renderer.frame += renderer.rowLabels[rowIndex];
+
+    for (int colIndex = 0; colIndex < board.numCols; colIndex++) {
+        renderer.frame.append((width - 1) / 2, ' ');
+        renderer.frame += shownCell(board, rowIndex, colIndex, isGameStart);
+        renderer.frame.append(width / 2, ' ');
+        renderer.frame += '|';
+    }
+}
+
+// function writes 'text' to standard output in one go. whatever is still
+// buffered in 'cout' goes out first so the output stays in order
+void writeOutput(const string& text) {
+    cout.flush();
+
+    size_t written = 0;
+
+    while (written < text.length()) {
+        ssize_t numWritten = write(STDOUT_FILENO, text.data() + written, text.length() - written);
+
+        if (numWritten < 0 && errno != EINTR) {
+            return;
+        }
+
+        written += max<ssize_t>(0, numWritten);
+    }
+}
+
+// function adds the escape sequence that moves the cursor to 'row', 'col' of
+// the terminal, counted from 1
+void appendCursorMove(string& frame, int row, int col) {
+    frame += "\x1b[";
+    frame += to_string(row);
+    frame += ';';
+    frame += to_string(col);
+    frame += 'H';
+}
+
+// function displays both players boards, side by side. the whole frame is
+// built in the renderer's buffer and written at once. in the diff mode the
+// first frame is pinned to the top of the terminal, the rest of the output
+// scrolls below it and later frames only redraw the cells that changed
+void displayBoards(BoardRenderer& renderer, const Board& board1, const Board& board2, bool isGameStart) {
+    TIME_PHASE(PHASE_RENDERING);
+
+    if (renderer.mode == RENDER_NONE) {
+        return;
+    }
+
+    if (renderer.numRows != board1.numRows || renderer.numCols != board1.numCols) {
+        layoutFrame(renderer, board1);
+    }
+
+    const Board* boards[2] = {&board1, &board2};
+    const int numCells = board1.numRows * board1.numCols;
+
+    renderer.frame.clear();
+
+    if (renderer.mode == RENDER_DIFF && renderer.isPinned) {
+        const int labelWidth = rowLabel(board1.numRows - 1).length();
+        const int width = cellWidth(board1.numCols);
+        const int boardWidth = board1.numCols * (width + 1) + 1;
+
+        // saves the cursor, draws the changed cells and puts the cursor back
+        renderer.frame += "\x1b" "7";
+
+        for (int boardIndex = 0; boardIndex < 2; boardIndex++) {
+            const int boardStart = boardIndex * (labelWidth + 1 + boardWidth + BOARD_SPACE);
+
+            for (int rowIndex = 0; rowIndex < board1.numRows; rowIndex++) {
+                for (int colIndex = 0; colIndex < board1.numCols; colIndex++) {
+                    char& shown = renderer.shownCells[boardIndex * numCells + rowIndex * board1.numCols + colIndex];
+                    char loc = shownCell(*boards[boardIndex], rowIndex, colIndex, isGameStart);
+
+                    if (shown == loc) {
+                        continue;
+                    }
+
+                    shown = loc;
+
+                    // the header and the first line come before the first
+                    // row, and every row is followed by a line
+                    appendCursorMove(renderer.frame, 3 + 2 * rowIndex, boardStart + labelWidth + 3 + colIndex * (width + 1) + (width - 1) / 2);
+                    renderer.frame += loc;
+                }
+            }
+        }
+
+        renderer.frame += "\x1b" "8";
+
+        writeOutput(renderer.frame);
+        return;
+    }
+
+    // the diff mode clears the terminal for its first frame
+    if (renderer.mode == RENDER_DIFF) {
+        renderer.frame += "\x1b[2J\x1b[H";
+    }
+
+    renderer.frame += renderer.header;
+    renderer.frame += renderer.line;
+
+    for (int rowIndex = 0; rowIndex < board1.numRows; rowIndex++) {
+        appendBoardRow(renderer, board1, rowIndex, isGameStart);
+        renderer.frame.append(BOARD_SPACE, ' ');
+        appendBoardRow(renderer, board2, rowIndex, isGameStart);
+        renderer.frame += renderer.line;
+    }
+
+    if (renderer.mode == RENDER_DIFF) {
+        const int frameHeight = 2 + 2 * board1.numRows;
+
+        for (int boardIndex = 0; boardIndex < 2; boardIndex++) {
+            for (int cell = 0; cell < numCells; cell++) {
+                renderer.shownCells[boardIndex * numCells + cell] = shownCell(*boards[boardIndex], cell / board1.numCols, cell % board1.numCols, isGameStart);
+            }
+        }
+
+        // everything printed from now on scrolls in the lines below the
+        // frame
+        renderer.frame += "\x1b[" + to_string(frameHeight + 1) + "r";
+        appendCursorMove(renderer.frame, frameHeight + 1, 1);
+
+        renderer.isPinned = true;
+    }
+
+    writeOutput(renderer.frame);
+}
+
+// function lets the whole terminal scroll again if the diff mode pinned a
+// frame to the top of it
+void closeRenderer(BoardRenderer& renderer) {
+    if (renderer.isPinned) {
+        cout << "\x1b[r" << "\x1b[999;1H" << flush;
+    }
+
+    renderer.isPinned = false;
+}
@@ -0,0 +1,302 @@
+#include "header.h"
+
+// function returns a cell as the game prints it, like "(B, 3)"
+string cellName(int rowIndex, int colIndex) {
+    return "(" + rowLabel(rowIndex) + ", " + to_string(colIndex + 1) + ")";
+}
+
+// function names shot 'shotNumber' of a game, counted from 0
+string shotName(int shotNumber, int shooter) {
+    return "shot " + to_string(shotNumber + 1) + ", by player " + to_string(shooter + 1) + ",";
+}
+
+// function describes a shot and how it turned out
+string describeShot(int rowIndex, int colIndex, ShotResult result, int shipId) {
+    const char* resultNames[] = {"missed", "hit ship", "sunk ship"};
+
+    string description = cellName(rowIndex, colIndex) + " and " + resultNames[result];
+
+    if (result != SHOT_MISS) {
+        description += " " + to_string(shipId);
+    }
+
+    return description;
+}
+
+// function checks if 'ship' lies where 'placement' says
+bool isPlacedAt(const Ship& ship, const RecordedPlacement& placement) {
+    const Point& start = ship.points.front();
+    const bool isVertical = ship.points.size() > 1 && ship.points[1].colIndex == start.colIndex;
+
+    return start.rowIndex == placement.rowIndex && start.colIndex == placement.colIndex && isVertical == (placement.orientation == 'V');
+}
+
+// function plays the record at 'reader' again, headless and without
+// rendering. the fleets a human placed and the shots a human fired are taken
+// from the record, everything a computer decides is made again from the
+// seed of the game and checked against the record. returns false if the
+// replay does not agree with the record, with what went wrong first in
+// 'divergence', or if the record is corrupt
+bool replayGame(RecordReader& reader, const GameConfig& config, ReplayScratch& scratch, RecordedGame& game, string& divergence) {
+    Player* players = scratch.context.players;
+
+    divergence.clear();
+
+    if (!readGameHeader(reader, game)) {
+        return false;
+    }
+
+    GameConfig gameConfig = config;
+
+    gameConfig.numRows = game.numRows;
+    gameConfig.numCols = game.numCols;
+
+    GameRng rng = makeGameRng(game.masterSeed, game.gameIndex);
+    GameSession session;
+
+    startGameSession(session, scratch.context, game.gameMode, gameConfig, rng, nullptr);
+
+    if ((int)players[0].fleet.size() != game.numShips) {
+        divergence = "the record has " + to_string(game.numShips) + " ships per fleet, " + config.shipsFile + " has " + to_string(players[0].fleet.size());
+        return false;
+    }
+
+    scratch.placements.resize(2 * game.numShips);
+
+    for (int placementIndex = 0; placementIndex < 2 * game.numShips; placementIndex++) {
+        RecordedPlacement& placement = scratch.placements[placementIndex];
+
+        if (!readPlacement(reader, game, placementIndex, placement)) {
+            return false;
+        }
+
+        if (placement.shipSize != players[placement.player].fleet[placement.shipId].size) {
+            divergence = "ship " + to_string(placement.shipId) + " has size " + to_string(placement.shipSize) + " in the record, but " + to_string(players[placement.player].fleet[placement.shipId].size) + " in " + config.shipsFile;
+            return false;
+        }
+    }
+
+    // a computer's fleet is placed at random when its turn to place comes,
+    // player 1's first, and has to end up where it was recorded
+    for (int player = 0; player < 2; player++) {
+        const RecordedPlacement* placements = &scratch.placements[player * game.numShips];
+
+        if (isComputerPlayer(game.gameMode, player) && !playComputerMove(session)) {
+            divergence = "player " + to_string(player + 1) + " could not place its fleet on a " + to_string(game.numRows) + "x" + to_string(game.numCols) + " board";
+            return false;
+        }
+
+        for (int shipId = 0; shipId < game.numShips; shipId++) {
+            const RecordedPlacement& placement = placements[shipId];
+
+            if (!isComputerPlayer(game.gameMode, player) && placeSessionShip(session, player, placement.rowIndex, placement.colIndex, placement.orientation) != MOVE_OK) {
+                reader.isCorrupt = true;
+                return false;
+            }
+
+            if (!isPlacedAt(players[player].fleet[shipId], placement)) {
+                const Point& start = players[player].fleet[shipId].points.front();
+
+                divergence = "player " + to_string(player + 1) + " placed ship " + to_string(shipId) + " at " + cellName(start.rowIndex, start.colIndex) + ", the record has it at " + cellName(placement.rowIndex, placement.colIndex) + " " + placement.orientation;
+                return false;
+            }
+        }
+    }
+
+    int shotNumber = 0;
+    RecordedShot shot;
+
+    for (; readShot(reader, game, shot); shotNumber++) {
+        if (session.stage == STAGE_OVER) {
+            divergence = "the replay ended after " + to_string(shotNumber) + " shots, the record goes on";
+            return false;
+        }
+
+        // the players always take turns, player 1 first, and only ever fire
+        // at the board
+        if (shot.shooter != session.player || shot.rowIndex < 0 || shot.rowIndex >= game.numRows || shot.colIndex < 0 || shot.colIndex >= game.numCols) {
+            reader.isCorrupt = true;
+            return false;
+        }
+
+        if (isComputerPlayer(game.gameMode, shot.shooter)) {
+            playComputerMove(session);
+        } else if (fireSessionShot(session, shot.rowIndex, shot.colIndex) == MOVE_ALREADY_FIRED) {
+            // 'handleShot()' never lets a human fire at a cell twice
+            divergence = shotName(shotNumber, shot.shooter) + " fires at " + cellName(shot.rowIndex, shot.colIndex) + " again";
+            return false;
+        }
+
+        const RecordedShot& fired = session.lastShot;
+
+        if (fired.rowIndex != shot.rowIndex || fired.colIndex != shot.colIndex || fired.result != shot.result || fired.shipId != shot.shipId) {
+            divergence = shotName(shotNumber, shot.shooter) + " fired at " + describeShot(fired.rowIndex, fired.colIndex, fired.result, fired.shipId) + ", the record has " + describeShot(shot.rowIndex, shot.colIndex, shot.result, shot.shipId);
+            return false;
+        }
+    }
+
+    if (reader.isCorrupt) {
+        return false;
+    }
+
+    if (session.stage != STAGE_OVER) {
+        divergence = "the record ends after " + to_string(shotNumber) + " shots, before a fleet was destroyed in the replay";
+        return false;
+    }
+
+    if (game.winner != session.winner) {
+        divergence = "player " + to_string(game.winner + 1) + " won in the record, player " + to_string(session.winner + 1) + " in the replay";
+        return false;
+    }
+
+    return true;
+}
+
+// function reads over the record at 'reader', keeping its header in 'game',
+// and adds its shots to 'numShots'. returns false at the end of the file or
+// if the record is corrupt
+bool skipGameRecord(RecordReader& reader, RecordedGame& game, long long& numShots) {
+    RecordedPlacement placement;
+    RecordedShot shot;
+
+    if (!readGameHeader(reader, game)) {
+        return false;
+    }
+
+    for (int placementIndex = 0; placementIndex < 2 * game.numShips; placementIndex++) {
+        readPlacement(reader, game, placementIndex, placement);
+    }
+
+    while (readShot(reader, game, shot)) {
+        numShots++;
+    }
+
+    return !reader.isCorrupt;
+}
+
+// function replays every game recorded in 'path' with the settings in
+// 'config', spread over 'numThreads' threads, and reports the first game
+// whose replay does not agree with its record. returns false if there is
+// one, or if the file can not be read
+bool replayGameRecords(const string& path, const GameConfig& config, int numThreads) {
+    const long long gamesPerChunk = 256;
+
+    GameRecordFile file;
+
+    if (!openGameRecordFile(file, path)) {
+        cout << "Can not read game records from " << path << "\n";
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    // finds where every record starts, so the games can be replayed in any
+    // order
+    vector<const uint8_t*> gameStarts;
+    vector<long long> gameShots;
+    RecordReader reader = makeRecordReader(file);
+
+    // the board sizes whose fleet has been checked to have a layout, which
+    // the computers need to place it. a record can give any size
+    vector<pair<int, int>> checkedBoards;
+    RecordedGame header;
+    string fleetError;
+
+    while (reader.next != reader.end) {
+        long long numShots = 0;
+
+        gameStarts.push_back(reader.next);
+
+        if (!skipGameRecord(reader, header, numShots)) {
+            cout << "The record of game " << gameStarts.size() << " is corrupt.\n";
+            closeGameRecordFile(file);
+            return false;
+        }
+
+        gameShots.push_back(numShots);
+
+        const pair<int, int> board = {header.numRows, header.numCols};
+
+        if (find(checkedBoards.begin(), checkedBoards.end(), board) != checkedBoards.end()) {
+            continue;
+        }
+
+        if (!checkFleetFits(*config.fleetTemplate, header.numRows, header.numCols, fleetError)) {
+            cout << "The record of game " << gameStarts.size() << " can not be replayed. " << fleetError << "\n";
+            closeGameRecordFile(file);
+            return false;
+        }
+
+        checkedBoards.push_back(board);
+    }
+
+    const long long numGames = gameStarts.size();
+    const int numChunks = (numGames + gamesPerChunk - 1) / gamesPerChunk;
+
+    numThreads = max(1, numThreads);
+
+    // the earliest game found to diverge so far. games after it are not
+    // replayed anymore
+    atomic<long long> firstDivergence(numGames);
+    mutex divergenceLock;
+    RecordedGame divergentGame;
+    string firstReport;
+
+    // the games that were played again and checked against their record,
+    // which stops short of the whole file once one diverges
+    atomic<long long> numReplayed(0);
+    atomic<long long> numShots(0);
+
+    vector<ReplayScratch> scratches(numThreads);
+
+    runParallel(numChunks, numThreads, [&](int chunk, int worker) {
+        RecordedGame game;
+        string divergence;
+
+        for (long long gameNumber = chunk * gamesPerChunk; gameNumber < min(numGames, (chunk + 1) * gamesPerChunk); gameNumber++) {
+            if (gameNumber >= firstDivergence) {
+                return;
+            }
+
+            RecordReader gameReader = makeRecordReader(file);
+
+            gameReader.next = gameStarts[gameNumber];
+
+            const bool isReplayed = replayGame(gameReader, config, scratches[worker], game, divergence);
+
+            if (!gameReader.isCorrupt) {
+                numReplayed++;
+                numShots += gameShots[gameNumber];
+            }
+
+            if (isReplayed) {
+                continue;
+            }
+
+            lock_guard<mutex> guard(divergenceLock);
+
+            if (gameNumber < firstDivergence) {
+                firstDivergence = gameNumber;
+                divergentGame = game;
+                firstReport = gameReader.isCorrupt ? "the record is corrupt" : divergence;
+            }
+
+            return;
+        }
+    });
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    closeGameRecordFile(file);
+
+    cout << fixed << setprecision(2);
+    cout << "Replayed " << numReplayed << " of " << numGames << " games (" << numShots << " shots) in " << elapsed.count() << "s (" << numReplayed / max(elapsed.count(), 1e-9) * 60 << " games/min)\n";
+
+    if (firstDivergence < numGames) {
+        cout << "Game " << firstDivergence + 1 << " (seed " << divergentGame.masterSeed << ", game index " << divergentGame.gameIndex << ", mode " << divergentGame.gameMode << ") diverged: " << firstReport << "\n";
+        return false;
+    }
+
+    cout << "Every game played out as recorded.\n";
+    return true;
+}
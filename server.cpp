@@ -0,0 +1,850 @@
+#include "header.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// the game server speaks a line protocol, one command per line in both
+// directions. a client sends
+//
+//   MODE 1                      play against another client
+//   MODE 2                      play against the computer
+//   PLACE <coordinate> <H|V>    place the next ship of the fleet
+//   FIRE <coordinate>           fire a shot
+//   QUIT                        leave the server
+//
+// and the server sends
+//
+//   BATTLESHIP <rows> <cols>    when the client has connected
+//   WAIT                        the client waits for another one to play
+//   START <1|2>                 a game has started, as player 1 or 2
+//   SHIP <name> <size>          the ship to place next
+//   READY                       the whole fleet is placed
+//   TURN                        it is the client's turn to fire
+//   SHOT <1|2> <coordinate> <MISS|HIT|SUNK> [ship]
+//                               player 1 or 2 fired, with the name of the
+//                               ship if it sank
+//   WIN, LOSE                   the game is over
+//   ABORT                       the computer could not lay out its fleet,
+//                               the game is over without a winner
+//   LEFT                        the opponent left, the game is over
+//   ERR <reason>                the command was not accepted
+//
+// coordinates are written like the game's prompts take them, such as 'B3'.
+// player 1 fires first. once a game is over the client can start another
+// one with MODE
+
+// the most events handled per wait, and how much of a socket is read at
+// a time
+const int SERVER_MAX_EVENTS = 256;
+const size_t SERVER_READ_BYTES = 1 << 14;
+
+// a line longer than this is not a command. a client that does not read
+// what it is sent is dropped once this much is waiting for it
+const size_t SERVER_MAX_LINE = 256;
+const size_t SERVER_MAX_OUTPUT = 1 << 20;
+
+// how many clients can wait to be paired for a game at once
+const int SERVER_MATCH_QUEUE = 1 << 16;
+
+// the server that SIGINT and SIGTERM stop
+static GameServer* signalledServer = nullptr;
+
+// function queues 'line' to be sent to 'session'. everything queued is sent
+// once the events read at the same time have been handled
+void sendLine(GameServer& server, ServerSession& session, const string& line) {
+    if (session.isClosing) {
+        return;
+    }
+
+    session.output += line;
+    session.output += '\n';
+
+    if (!session.isFlushQueued) {
+        session.isFlushQueued = true;
+        server.flushQueue.push_back(session.descriptor);
+    }
+}
+
+// function sends 'line' to the player 'player' of 'match', unless it is the
+// computer
+void sendToPlayer(GameServer& server, ServerMatch& match, int player, const string& line) {
+    if (match.sessions[player] != -1) {
+        sendLine(server, server.sessions[match.sessions[player]], line);
+    }
+}
+
+// function returns a cell the way a client writes it, like "B3"
+string coordinateName(int rowIndex, int colIndex) {
+    return rowLabel(rowIndex) + to_string(colIndex + 1);
+}
+
+// function asks the player 'player' of 'match' for its next ship
+void sendNextShip(GameServer& server, ServerMatch& match, int player) {
+    const Ship& ship = match.context.players[player].fleet[match.session.shipsPlaced[player]];
+
+    sendToPlayer(server, match, player, "SHIP " + ship.name + " " + to_string(ship.size));
+}
+
+// function starts a game of 'gameMode' between the sessions 'first' and
+// 'second'. in game mode 2 'second' is -1 and the computer places its fleet
+// once the client has placed theirs
+void startMatch(GameServer& server, int gameMode, int first, int second) {
+    int matchIndex;
+
+    if (!server.freeMatches.empty()) {
+        matchIndex = server.freeMatches.back();
+        server.freeMatches.pop_back();
+    } else {
+        matchIndex = server.matches.size();
+        server.matches.emplace_back();
+    }
+
+    ServerMatch& match = server.matches[matchIndex];
+
+    match.gameMode = gameMode;
+    match.sessions[0] = first;
+    match.sessions[1] = second;
+    match.gameIndex = server.numGamesStarted++;
+    match.rng = makeGameRng(server.masterSeed, match.gameIndex);
+
+    GameRecorder* recorder = nullptr;
+
+    if (server.writer != nullptr) {
+        match.recorder.masterSeed = server.masterSeed;
+        match.recorder.gameIndex = match.gameIndex;
+        match.recorder.gameMode = gameMode;
+        recorder = &match.recorder;
+    }
+
+    startGameSession(match.session, match.context, gameMode, server.config, match.rng, recorder);
+
+    for (int player = 0; player < 2; player++) {
+        if (match.sessions[player] == -1) {
+            continue;
+        }
+
+        ServerSession& session = server.sessions[match.sessions[player]];
+
+        session.state = SESSION_PLAYING;
+        session.match = matchIndex;
+        session.player = player;
+
+        sendLine(server, session, "START " + to_string(player + 1));
+        sendNextShip(server, match, player);
+    }
+}
+
+// function ends match 'matchIndex' and puts its players back in the lobby
+void endMatch(GameServer& server, int matchIndex) {
+    ServerMatch& match = server.matches[matchIndex];
+
+    for (int player = 0; player < 2; player++) {
+        if (match.sessions[player] == -1) {
+            continue;
+        }
+
+        ServerSession& session = server.sessions[match.sessions[player]];
+
+        session.state = SESSION_LOBBY;
+        session.match = -1;
+    }
+
+    server.freeMatches.push_back(matchIndex);
+}
+
+// function tells both players of 'match' how the last shot turned out
+void reportShot(GameServer& server, ServerMatch& match) {
+    const char* resultNames[] = {"MISS", "HIT", "SUNK"};
+
+    const RecordedShot& shot = match.session.lastShot;
+    const int target = 1 - shot.shooter;
+
+    string line = "SHOT " + to_string(shot.shooter + 1) + " " + coordinateName(shot.rowIndex, shot.colIndex) + " " + resultNames[shot.result];
+
+    // the ship that just sunk sits right after the ships still afloat
+    if (shot.result == SHOT_SINK) {
+        line += " " + match.context.players[target].fleet[match.context.numShips[target]].name;
+    }
+
+    sendToPlayer(server, match, 0, line);
+    sendToPlayer(server, match, 1, line);
+}
+
+// function declares the winner of match 'matchIndex' and ends it. the game
+// session has already finished the record. a match that ended without a
+// winner is called off and not recorded
+void finishMatch(GameServer& server, int matchIndex) {
+    ServerMatch& match = server.matches[matchIndex];
+    const int winner = match.session.winner;
+
+    if (winner < 0) {
+        sendToPlayer(server, match, 0, "ABORT");
+        sendToPlayer(server, match, 1, "ABORT");
+        endMatch(server, matchIndex);
+        return;
+    }
+
+    sendToPlayer(server, match, winner, "WIN");
+    sendToPlayer(server, match, 1 - winner, "LOSE");
+
+    if (server.writer != nullptr) {
+        writeGameRecord(*server.writer, match.recorder);
+    }
+
+    server.numGamesFinished++;
+
+    endMatch(server, matchIndex);
+}
+
+// function plays the moves of the computer in 'match' until a client is to
+// move or the game is over. the computer fires with the solver, samplers and
+// sampler threads of the server, which it only needs for the length of its
+// turn
+void playComputerMoves(GameServer& server, ServerMatch& match) {
+    while (isComputerToMove(match.session)) {
+        ComputerState& computer = match.context.computers[match.session.player];
+        const bool isShot = (match.session.stage == STAGE_FIRING);
+
+        swap(computer.solver, server.solver);
+        swap(computer.samplers, server.samplers);
+        swap(computer.samplerThreads.pool, server.samplerPool);
+
+        playComputerMove(match.session);
+
+        swap(computer.solver, server.solver);
+        swap(computer.samplers, server.samplers);
+        swap(computer.samplerThreads.pool, server.samplerPool);
+
+        if (isShot) {
+            reportShot(server, match);
+        }
+    }
+}
+
+// function returns the reason sent back for a move that can not be made
+string moveErrorReason(MoveError error) {
+    const char* reasons[] = {"", "invalid coordinate", "already fired there", "invalid orientation", "outside the board", "space occupied"};
+
+    return string("ERR ") + reasons[error];
+}
+
+// function handles 'MODE <1|2>'
+void handleMode(GameServer& server, ServerSession& session, const char* mode, size_t length) {
+    if (session.state != SESSION_LOBBY) {
+        sendLine(server, session, "ERR already in a game");
+        return;
+    }
+
+    if (length != 1 || (mode[0] != '1' && mode[0] != '2')) {
+        sendLine(server, session, "ERR invalid mode");
+        return;
+    }
+
+    const int gameMode = mode[0] - '0';
+
+    if (!queueMatchTicket(server.matchmaker, session.descriptor, gameMode, session.queuedAt)) {
+        sendLine(server, session, "ERR server busy");
+        return;
+    }
+
+    session.state = SESSION_WAITING;
+
+    // a game against the computer starts as soon as the ticket is paired
+    if (gameMode == 1) {
+        sendLine(server, session, "WAIT");
+    }
+}
+
+// function checks if 'ticket' is the one its client is still waiting on
+bool isTicketQueued(GameServer& server, const MatchTicket& ticket) {
+    if (ticket.player >= server.sessions.size()) {
+        return false;
+    }
+
+    const ServerSession& session = server.sessions[ticket.player];
+
+    return session.descriptor == (int)ticket.player && session.state == SESSION_WAITING && !session.isClosing && session.queuedAt == ticket.queuedAt;
+}
+
+// function queues 'ticket' again, with the time it was first queued at, or
+// sends its client back to the lobby if there is no room for it
+void requeueTicket(GameServer& server, const MatchTicket& ticket) {
+    if (!pushMatchTicket(server.matchmaker.queue, ticket)) {
+        ServerSession& session = server.sessions[ticket.player];
+
+        session.state = SESSION_LOBBY;
+        sendLine(server, session, "ERR server busy");
+    }
+}
+
+// function starts the games of the clients queued while the last events
+// were handled. a ticket whose client has left or gone back to the lobby
+// since is dropped, and the client it was paired with queued again
+void pairQueuedSessions(GameServer& server) {
+    const int numQueued = matchQueueDepth(server.matchmaker.queue);
+
+    pairMatchTickets(server.matchmaker, server.matchmaking, numQueued, [&](const MatchTicket& first, const MatchTicket* second) {
+        const bool isFirstQueued = isTicketQueued(server, first);
+
+        if (second == nullptr) {
+            if (isFirstQueued) {
+                startMatch(server, 2, first.player, -1);
+            }
+
+            return;
+        }
+
+        const bool isSecondQueued = isTicketQueued(server, *second);
+
+        if (isFirstQueued && isSecondQueued) {
+            startMatch(server, 1, first.player, second->player);
+        } else if (isFirstQueued) {
+            requeueTicket(server, first);
+        } else if (isSecondQueued) {
+            requeueTicket(server, *second);
+        }
+    });
+}
+
+// function handles 'PLACE <coordinate> <H|V>'
+void handlePlace(GameServer& server, ServerSession& session, const char* coordinate, size_t coordinateLength, const char* orientation, size_t orientationLength) {
+    if (session.state != SESSION_PLAYING) {
+        sendLine(server, session, "ERR not in a game");
+        return;
+    }
+
+    ServerMatch& match = server.matches[session.match];
+    Player& player = match.context.players[session.player];
+
+    if (match.session.shipsPlaced[session.player] == (int)player.fleet.size()) {
+        sendLine(server, session, "ERR fleet already placed");
+        return;
+    }
+
+    int rowIndex, colIndex;
+
+    if (!isValidCoordinate(coordinate, coordinateLength, rowIndex, colIndex, player.board.numRows, player.board.numCols)) {
+        sendLine(server, session, moveErrorReason(MOVE_INVALID_COORDINATE));
+        return;
+    }
+
+    // only one letter is an orientation
+    const char shipOrientation = (orientationLength == 1) ? toupper(orientation[0]) : ' ';
+
+    MoveError error = placeSessionShip(match.session, session.player, rowIndex, colIndex, shipOrientation);
+
+    if (error != MOVE_OK) {
+        sendLine(server, session, moveErrorReason(error));
+        return;
+    }
+
+    // in game mode 2 the computer places its fleet once the client is done
+    playComputerMoves(server, match);
+
+    if (match.session.stage == STAGE_OVER) {
+        finishMatch(server, session.match);
+        return;
+    }
+
+    if (match.session.shipsPlaced[session.player] < (int)player.fleet.size()) {
+        sendNextShip(server, match, session.player);
+        return;
+    }
+
+    sendLine(server, session, "READY");
+
+    // the game starts once both fleets are placed
+    if (match.session.stage == STAGE_FIRING) {
+        sendToPlayer(server, match, match.session.player, "TURN");
+    }
+}
+
+// function handles 'FIRE <coordinate>'. in game mode 2 the computer fires
+// back straight away
+void handleFire(GameServer& server, ServerSession& session, const char* coordinate, size_t length) {
+    const char hitSymbol = 'X';
+    const char missSymbol = 'O';
+
+    if (session.state != SESSION_PLAYING) {
+        sendLine(server, session, "ERR not in a game");
+        return;
+    }
+
+    const int matchIndex = session.match;
+    ServerMatch& match = server.matches[matchIndex];
+
+    if (match.session.stage != STAGE_FIRING || match.session.player != session.player) {
+        sendLine(server, session, "ERR not your turn");
+        return;
+    }
+
+    int rowIndex, colIndex;
+
+    MoveError error = checkShot(match.context.players[1 - session.player], coordinate, length, rowIndex, colIndex, hitSymbol, missSymbol);
+
+    if (error != MOVE_OK) {
+        sendLine(server, session, moveErrorReason(error));
+        return;
+    }
+
+    fireSessionShot(match.session, rowIndex, colIndex);
+    reportShot(server, match);
+    playComputerMoves(server, match);
+
+    if (match.session.stage == STAGE_OVER) {
+        finishMatch(server, matchIndex);
+        return;
+    }
+
+    sendToPlayer(server, match, match.session.player, "TURN");
+}
+
+// function takes 'session' out of its game, or out of the wait for one. the
+// opponent is told and goes back to the lobby
+void leaveMatch(GameServer& server, ServerSession& session) {
+    // a ticket still in the queue is dropped once it is paired
+    if (session.state == SESSION_WAITING) {
+        cancelMatchTicket(server.matchmaker, session.descriptor, session.queuedAt);
+    }
+
+    if (session.state == SESSION_PLAYING) {
+        sendToPlayer(server, server.matches[session.match], 1 - session.player, "LEFT");
+        endMatch(server, session.match);
+    }
+
+    session.state = SESSION_LOBBY;
+}
+
+// function drops 'session'. what it was playing ends now, the socket is
+// closed once the events read at the same time have been handled
+void closeSession(GameServer& server, ServerSession& session) {
+    if (session.isClosing) {
+        return;
+    }
+
+    leaveMatch(server, session);
+
+    session.isClosing = true;
+    server.closeQueue.push_back(session.descriptor);
+}
+
+// function splits 'line' into at most 'maxTokens' tokens separated by
+// spaces or tabs. returns how many there are
+int splitLine(const char* line, size_t length, const char* tokens[], size_t lengths[], int maxTokens) {
+    int numTokens = 0;
+    size_t index = 0;
+
+    while (index < length && numTokens < maxTokens) {
+        while (index < length && (line[index] == ' ' || line[index] == '\t')) {
+            index++;
+        }
+
+        if (index == length) {
+            break;
+        }
+
+        tokens[numTokens] = line + index;
+
+        while (index < length && line[index] != ' ' && line[index] != '\t') {
+            index++;
+        }
+
+        lengths[numTokens] = line + index - tokens[numTokens];
+        numTokens++;
+    }
+
+    return numTokens;
+}
+
+// function checks if 'token' is the command 'command', in any case
+bool isCommand(const char* token, size_t length, const char* command) {
+    return length == strlen(command) && strncasecmp(token, command, length) == 0;
+}
+
+// function handles one line a client sent, without its newline
+void handleLine(GameServer& server, ServerSession& session, const char* line, size_t length) {
+    const int maxTokens = 4;
+
+    if (length > 0 && line[length - 1] == '\r') {
+        length--;
+    }
+
+    const char* tokens[maxTokens];
+    size_t lengths[maxTokens];
+    int numTokens = splitLine(line, length, tokens, lengths, maxTokens);
+
+    if (numTokens == 0) {
+        return;
+    }
+
+    if (isCommand(tokens[0], lengths[0], "FIRE") && numTokens == 2) {
+        handleFire(server, session, tokens[1], lengths[1]);
+    } else if (isCommand(tokens[0], lengths[0], "PLACE") && numTokens == 3) {
+        handlePlace(server, session, tokens[1], lengths[1], tokens[2], lengths[2]);
+    } else if (isCommand(tokens[0], lengths[0], "MODE") && numTokens == 2) {
+        handleMode(server, session, tokens[1], lengths[1]);
+    } else if (isCommand(tokens[0], lengths[0], "QUIT") && numTokens == 1) {
+        closeSession(server, session);
+    } else {
+        sendLine(server, session, "ERR unknown command");
+    }
+}
+
+// function reads what 'session' has sent and handles every whole line of it
+void readSession(GameServer& server, ServerSession& session) {
+    ssize_t numRead = read(session.descriptor, server.readBuffer.data(), server.readBuffer.size());
+
+    if (numRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+
+    if (numRead <= 0) {
+        closeSession(server, session);
+        return;
+    }
+
+    session.input.append(server.readBuffer.data(), numRead);
+
+    size_t start = 0;
+    size_t newline;
+
+    while (!session.isClosing && (newline = session.input.find('\n', start)) != string::npos) {
+        handleLine(server, session, session.input.data() + start, newline - start);
+        start = newline + 1;
+    }
+
+    session.input.erase(0, start);
+
+    if (session.input.length() > SERVER_MAX_LINE) {
+        sendLine(server, session, "ERR line too long");
+        closeSession(server, session);
+    }
+}
+
+// function watches 'session' for being able to write again while it has
+// output waiting, and stops watching once it has none
+void watchWritable(GameServer& server, ServerSession& session, bool isWaitingToWrite) {
+    if (session.isWaitingToWrite == isWaitingToWrite) {
+        return;
+    }
+
+    epoll_event event = {};
+    uint32_t events = EPOLLIN;
+
+    if (isWaitingToWrite) {
+        events |= EPOLLOUT;
+    }
+
+    event.events = events;
+    event.data.fd = session.descriptor;
+
+    epoll_ctl(server.epoll, EPOLL_CTL_MOD, session.descriptor, &event);
+    session.isWaitingToWrite = isWaitingToWrite;
+}
+
+// function sends as much of the output of 'session' as its socket takes
+// without blocking
+void flushSession(GameServer& server, ServerSession& session) {
+    size_t sent = 0;
+
+    while (sent < session.output.length()) {
+        ssize_t numSent = send(session.descriptor, session.output.data() + sent, session.output.length() - sent, MSG_NOSIGNAL);
+
+        if (numSent < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (numSent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeSession(server, session);
+                return;
+            }
+
+            break;
+        }
+
+        sent += numSent;
+    }
+
+    session.output.erase(0, sent);
+
+    if (session.output.length() > SERVER_MAX_OUTPUT) {
+        closeSession(server, session);
+        return;
+    }
+
+    watchWritable(server, session, !session.output.empty());
+}
+
+// function accepts every connection waiting on the listening socket
+void acceptSessions(GameServer& server) {
+    while (true) {
+        int descriptor = accept4(server.listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (descriptor < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // out of descriptors, the connection is accepted with the spare one
+        // and closed straight away so it does not wake the server forever
+        if (descriptor < 0 && (errno == EMFILE || errno == ENFILE) && server.spare != -1) {
+            close(server.spare);
+            close(accept(server.listener, nullptr, nullptr));
+            server.spare = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            continue;
+        }
+
+        if (descriptor < 0) {
+            return;
+        }
+
+        // the lines are short and answered one at a time
+        int isNoDelay = 1;
+
+        setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &isNoDelay, sizeof(isNoDelay));
+
+        if (descriptor >= (int)server.sessions.size()) {
+            server.sessions.resize(descriptor + 1);
+        }
+
+        ServerSession& session = server.sessions[descriptor];
+
+        session.descriptor = descriptor;
+        session.state = SESSION_LOBBY;
+        session.input.clear();
+        session.output.clear();
+        session.match = -1;
+        session.isFlushQueued = false;
+        session.isWaitingToWrite = false;
+        session.isClosing = false;
+
+        epoll_event event = {};
+
+        event.events = EPOLLIN;
+        event.data.fd = descriptor;
+
+        epoll_ctl(server.epoll, EPOLL_CTL_ADD, descriptor, &event);
+
+        server.numSessions++;
+        server.numConnections++;
+
+        sendLine(server, session, "BATTLESHIP " + to_string(server.config.numRows) + " " + to_string(server.config.numCols));
+    }
+}
+
+// function pairs the clients queued while the last events were handled,
+// sends the output queued meanwhile, and then closes the sessions that were
+// dropped. a dropped session gets one last try at sending what is left for
+// it
+void finishEvents(GameServer& server) {
+    pairQueuedSessions(server);
+
+    for (size_t index = 0; index < server.flushQueue.size(); index++) {
+        ServerSession& session = server.sessions[server.flushQueue[index]];
+
+        session.isFlushQueued = false;
+
+        if (!session.isClosing) {
+            flushSession(server, session);
+        }
+    }
+
+    server.flushQueue.clear();
+
+    for (int descriptor : server.closeQueue) {
+        ServerSession& session = server.sessions[descriptor];
+
+        if (!session.output.empty()) {
+            send(descriptor, session.output.data(), session.output.length(), MSG_NOSIGNAL);
+        }
+
+        close(descriptor);
+
+        session.descriptor = -1;
+        session.input.clear();
+        session.output.clear();
+
+        server.numSessions--;
+    }
+
+    server.closeQueue.clear();
+}
+
+// function sets up 'server' to listen on 'address', 'port'. port 0 picks a
+// free port, which is left in 'server.port'. the limit on open descriptors
+// is raised as far as it goes so the server can hold many clients. returns
+// false with the problem in 'error' if it can not listen
+bool openGameServer(GameServer& server, const string& address, int port, string& error) {
+    rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    sockaddr_in socketAddress = {};
+
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1) {
+        error = "Not an IPv4 address: " + address;
+        return false;
+    }
+
+    server.listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    int isReused = 1;
+
+    setsockopt(server.listener, SOL_SOCKET, SO_REUSEADDR, &isReused, sizeof(isReused));
+
+    if (server.listener < 0 || bind(server.listener, (sockaddr*)&socketAddress, sizeof(socketAddress)) != 0 || listen(server.listener, SOMAXCONN) != 0) {
+        error = "Can not listen on " + address + ":" + to_string(port);
+        closeGameServer(server);
+        return false;
+    }
+
+    socklen_t addressLength = sizeof(socketAddress);
+
+    getsockname(server.listener, (sockaddr*)&socketAddress, &addressLength);
+    server.port = ntohs(socketAddress.sin_port);
+
+    server.epoll = epoll_create1(EPOLL_CLOEXEC);
+    server.wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server.spare = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    if (server.epoll < 0 || server.wakeup < 0) {
+        error = "Can not set up the event loop";
+        closeGameServer(server);
+        return false;
+    }
+
+    for (int descriptor : {server.listener, server.wakeup}) {
+        epoll_event event = {};
+
+        event.events = EPOLLIN;
+        event.data.fd = descriptor;
+
+        epoll_ctl(server.epoll, EPOLL_CTL_ADD, descriptor, &event);
+    }
+
+    server.readBuffer.resize(SERVER_READ_BYTES);
+    server.isStopping = false;
+
+    openMatchmaker(server.matchmaker, SERVER_MATCH_QUEUE);
+
+    return true;
+}
+
+// function runs the server on the calling thread until 'stopGameServer()'
+// is called
+void runGameServer(GameServer& server) {
+    epoll_event events[SERVER_MAX_EVENTS];
+
+    while (!server.isStopping) {
+        int numEvents = epoll_wait(server.epoll, events, SERVER_MAX_EVENTS, -1);
+
+        if (numEvents < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (numEvents < 0) {
+            break;
+        }
+
+        for (int eventIndex = 0; eventIndex < numEvents; eventIndex++) {
+            const int descriptor = events[eventIndex].data.fd;
+            const uint32_t flags = events[eventIndex].events;
+
+            if (descriptor == server.listener) {
+                acceptSessions(server);
+                continue;
+            }
+
+            if (descriptor == server.wakeup) {
+                server.isStopping = true;
+                continue;
+            }
+
+            ServerSession& session = server.sessions[descriptor];
+
+            if (session.isClosing) {
+                continue;
+            }
+
+            // whatever arrived before the client hung up is still handled
+            if (flags & EPOLLIN) {
+                readSession(server, session);
+            } else if (flags & (EPOLLERR | EPOLLHUP)) {
+                closeSession(server, session);
+            }
+
+            if ((flags & EPOLLOUT) && !session.isClosing) {
+                flushSession(server, session);
+            }
+        }
+
+        finishEvents(server);
+    }
+}
+
+// function makes 'runGameServer()' return. it only writes to the eventfd,
+// so it can be called from any thread and from a signal handler
+void stopGameServer(GameServer& server) {
+    const uint64_t one = 1;
+
+    if (write(server.wakeup, &one, sizeof(one)) < 0) {
+        return;
+    }
+}
+
+// function is the SIGINT and SIGTERM handler
+void stopSignalledServer(int) {
+    if (signalledServer != nullptr) {
+        stopGameServer(*signalledServer);
+    }
+}
+
+// function makes SIGINT and SIGTERM stop 'server', so it can close down and
+// write out its records
+void installServerStopSignals(GameServer& server) {
+    signalledServer = &server;
+
+    signal(SIGINT, stopSignalledServer);
+    signal(SIGTERM, stopSignalledServer);
+}
+
+// function closes every session and the server's own descriptors
+void closeGameServer(GameServer& server) {
+    for (ServerSession& session : server.sessions) {
+        if (session.descriptor != -1) {
+            close(session.descriptor);
+            session.descriptor = -1;
+        }
+    }
+
+    for (int* descriptor : {&server.listener, &server.epoll, &server.wakeup, &server.spare}) {
+        if (*descriptor != -1) {
+            close(*descriptor);
+        }
+
+        *descriptor = -1;
+    }
+
+    if (signalledServer == &server) {
+        signalledServer = nullptr;
+    }
+
+    server.sessions.clear();
+    server.numSessions = 0;
+}
@@ -0,0 +1,172 @@
+#include "header.h"
+
+// function checks if 'player' (0 or 1) is played by a computer in 'gameMode'.
+// headless games are mode 0
+bool isComputerPlayer(int gameMode, int player) {
+    return gameMode == 0 || gameMode == 3 || (gameMode == 2 && player == 1);
+}
+
+// function moves 'session' on after a move. the game waits for the first
+// player whose fleet is not placed yet, and once both are it starts with a
+// shot by player 1
+void advanceSession(GameSession& session) {
+    GameContext& context = *session.context;
+
+    for (int player = 0; player < 2; player++) {
+        if (session.shipsPlaced[player] < (int)context.players[player].fleet.size()) {
+            session.stage = STAGE_PLACING;
+            session.player = player;
+            return;
+        }
+    }
+
+    session.stage = STAGE_FIRING;
+    session.player = 0;
+
+    if (session.recorder != nullptr) {
+        startGameRecord(*session.recorder, context.players[0], context.players[1]);
+    }
+}
+
+// function starts a game of 'gameMode' in 'context' and waits for its first
+// move. 'rng' is what the computers draw from and has to outlive the game.
+// if 'recorder' is not null the placements and every shot are recorded into
+// it, with the game mode the caller set in it
+void startGameSession(GameSession& session, GameContext& context, int gameMode, const GameConfig& config, GameRng& rng, GameRecorder* recorder) {
+    resetGameContext(context, config);
+
+    session.context = &context;
+    session.gameMode = gameMode;
+    session.rng = &rng;
+    session.recorder = recorder;
+    session.winner = -1;
+
+    session.shipsPlaced[0] = 0;
+    session.shipsPlaced[1] = 0;
+
+    advanceSession(session);
+}
+
+// function places the next ship of 'player' at 'rowIndex', 'colIndex' along
+// 'orientation'. the players may place their fleets in any order, a game
+// only waits for them one at a time. returns why the ship can not go there
+// if it can not
+MoveError placeSessionShip(GameSession& session, int player, int rowIndex, int colIndex, char orientation) {
+    Player& placer = session.context->players[player];
+    const int shipIndex = session.shipsPlaced[player];
+
+    MoveError error = checkShipPlacement(placer, rowIndex, colIndex, orientation, placer.fleet[shipIndex].size);
+
+    if (error != MOVE_OK) {
+        return error;
+    }
+
+    placeShipAt(placer, shipIndex, rowIndex, colIndex, orientation);
+    session.shipsPlaced[player]++;
+
+    advanceSession(session);
+
+    return MOVE_OK;
+}
+
+// function finishes the shot the player to move just fired at 'rowIndex',
+// 'colIndex': it keeps what it did in 'session.lastShot', records it and
+// hands the turn over, or ends the game if it sank the last ship
+void finishSessionShot(GameSession& session, int rowIndex, int colIndex, int numShipsBefore) {
+    GameContext& context = *session.context;
+    RecordedShot& shot = session.lastShot;
+
+    const int shooter = session.player;
+    const int target = 1 - shooter;
+
+    shot.shooter = shooter;
+    shot.rowIndex = rowIndex;
+    shot.colIndex = colIndex;
+    shot.result = classifyShot(context.players[target], context.numShips[target], numShipsBefore, rowIndex, colIndex, shot.shipId);
+
+    context.shotsFired[shooter]++;
+
+    if (session.recorder != nullptr) {
+        recordShotEvent(*session.recorder, shooter, context.players[target], context.numShips[target], numShipsBefore, rowIndex, colIndex);
+    }
+
+    if (context.numShips[target] > 0) {
+        session.player = target;
+        return;
+    }
+
+    session.stage = STAGE_OVER;
+    session.winner = shooter;
+
+    if (session.recorder != nullptr) {
+        finishGameRecord(*session.recorder, shooter);
+    }
+}
+
+// function fires the shot of the player to move at 'rowIndex', 'colIndex'.
+// returns 'MOVE_ALREADY_FIRED' without firing if the cell has been shot
+MoveError fireSessionShot(GameSession& session, int rowIndex, int colIndex) {
+    const char hitSymbol = 'X';
+    const char missSymbol = 'O';
+
+    GameContext& context = *session.context;
+    const int target = 1 - session.player;
+
+    Player& opponent = context.players[target];
+
+    if (opponent.board[rowIndex][colIndex] == hitSymbol || opponent.board[rowIndex][colIndex] == missSymbol) {
+        return MOVE_ALREADY_FIRED;
+    }
+
+    const int numShipsBefore = context.numShips[target];
+    bool hasShipSunk = false;
+
+    {
+        TIME_PHASE(PHASE_HIT_RESOLUTION);
+        checkForHit(opponent, context.numShips[target], rowIndex, colIndex, hitSymbol, missSymbol, false, hasShipSunk, false);
+    }
+
+    finishSessionShot(session, rowIndex, colIndex, numShipsBefore);
+
+    return MOVE_OK;
+}
+
+// function has the computer to move take its turn. a computer places its
+// whole fleet in one move, at random or from its layout book. player 1
+// fires with 'computers[0]' and player 2 with 'computers[1]'. returns false
+// if the fleet has no layout on the board, which ends the game without a
+// winner
+bool playComputerMove(GameSession& session) {
+    GameContext& context = *session.context;
+    ComputerState& computer = context.computers[session.player];
+
+    const int target = 1 - session.player;
+
+    if (session.stage == STAGE_PLACING) {
+        if (computer.layoutBook != nullptr) {
+            placeBookLayout(context.players[session.player], *computer.layoutBook, *session.rng);
+        } else if (!computerStartShipPlacement(context.players[target], context.players[session.player], *session.rng)) {
+            session.stage = STAGE_OVER;
+            session.winner = -1;
+            return false;
+        }
+
+        session.shipsPlaced[session.player] = context.players[session.player].fleet.size();
+
+        advanceSession(session);
+        return true;
+    }
+
+    const int numShipsBefore = context.numShips[target];
+
+    computerTurn(context.players[target], context.numShips[target], computer, *session.rng, false);
+
+    finishSessionShot(session, computer.lastShot.rowIndex, computer.lastShot.colIndex, numShipsBefore);
+
+    return true;
+}
+
+// function checks if the game is waiting for a computer's move
+bool isComputerToMove(const GameSession& session) {
+    return session.stage != STAGE_OVER && isComputerPlayer(session.gameMode, session.player);
+}
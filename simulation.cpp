@@ -0,0 +1,307 @@
+#include "header.h"
+
+// function creates the random number generator for one game. the generator
+// only depends on the master seed and the index of the game, so a batch of
+// games gives the same results no matter which thread plays which game, and
+// any game can be played again from the two numbers
+GameRng makeGameRng(uint64_t masterSeed, uint64_t gameIndex) {
+    // the game index is scrambled before it is mixed in, so neighbouring
+    // games of one seed get unrelated streams
+    GameRng indexMixer(gameIndex);
+
+    return GameRng(masterSeed ^ indexMixer());
+}
+
+// function gets 'context' ready for a new game under 'config': empty boards
+// with the whole fleets, and computers that have not fired yet. the fresh
+// state is only built again when the board size or the fleet changes, every
+// other reset copies it over the last game, which reuses the memory that
+// game had
+void resetGameContext(GameContext& context, const GameConfig& config) {
+    if (context.fleetTemplate == nullptr || context.fleetTemplate != config.fleetTemplate.get() ||
+        context.numRows != config.numRows || context.numCols != config.numCols) {
+        initFleet(context.freshPlayer, config);
+        initPlacementIndex(context.freshIndex, config.numRows, config.numCols, context.freshPlayer.fleet, context.freshPlayer.fleet.size());
+
+        context.numRows = config.numRows;
+        context.numCols = config.numCols;
+        context.fleetTemplate = config.fleetTemplate.get();
+    }
+
+    // the layouts are looked up here only if the caller has not done it
+    // once for all the games
+    const LayoutBook* layoutBook = config.layoutBook.get();
+
+    if (layoutBook == nullptr && (config.placements[0] == ADVERSARIAL_PLACEMENT || config.placements[1] == ADVERSARIAL_PLACEMENT)) {
+        layoutBook = findLayoutBook(config).get();
+    }
+
+    for (int player = 0; player < 2; player++) {
+        ComputerState& computer = context.computers[player];
+
+        context.players[player] = context.freshPlayer;
+        context.numShips[player] = context.freshPlayer.fleet.size();
+        context.shotsFired[player] = 0;
+
+        resetComputerState(computer);
+
+        computer.engine = config.engines[player];
+        computer.monteCarlo = config.monteCarlo;
+        computer.exactSolver = config.exactSolver;
+        computer.layoutBook = (config.placements[player] == ADVERSARIAL_PLACEMENT) ? layoutBook : nullptr;
+
+        // neither fleet has been shot at, so the index is the fresh one
+        computer.placementIndex = context.freshIndex;
+        prepareTargeting(computer, config.numRows, config.numCols);
+    }
+}
+
+// function plays one headless computer vs computer game in 'context'.
+// nothing is printed and no boards are displayed. returns the winner (0 for
+// computer 1, 1 for computer 2), or -1 if a fleet could not be laid out on
+// the board, and leaves the number of shots each
+// computer took in 'context.shotsFired'. if 'recorder' is not null the
+// placements and every shot are recorded into it
+int simulateGame(GameContext& context, const GameConfig& config, GameRng& rng, GameRecorder* recorder) {
+    GameSession session;
+
+    // the first two moves place the fleets at random, computer 1's first.
+    // computer 1 always fires first, the computers then alternate until
+    // one of the fleets is destroyed
+    startGameSession(session, context, 0, config, rng, recorder);
+
+    while (session.stage != STAGE_OVER) {
+        playComputerMove(session);
+    }
+
+    return session.winner;
+}
+
+// function runs the headless games 'firstGame' up to 'firstGame + numGames'
+// in 'context' and accumulates the results into 'stats'. if 'writer' is not
+// null every game is recorded into it through 'recorder'. the context and
+// recorder belong to the caller, so a worker keeps their buffers from one
+// batch to the next
+void runSimulations(long long firstGame, long long numGames, uint64_t masterSeed, const GameConfig& config, GameContext& context, GameRecorder& recorder, SimulationStats& stats, GameRecordWriter* writer) {
+    recorder.masterSeed = masterSeed;
+
+    for (long long game = firstGame; game < firstGame + numGames; game++) {
+        GameRng rng = makeGameRng(masterSeed, game);
+
+        // prints the turn stats between games if they were asked for
+        POLL_TURN_STATS();
+
+        recorder.gameIndex = game;
+
+        int winner = simulateGame(context, config, rng, (writer != nullptr) ? &recorder : nullptr);
+        const int* shotsFired = context.shotsFired;
+
+        // a game without a winner ended before the first shot, so there is
+        // nothing to record or to count in the results
+        if (winner < 0) {
+            stats.numUnplayable++;
+            continue;
+        }
+
+        if (writer != nullptr) {
+            writeGameRecord(*writer, recorder);
+        }
+
+        if ((int)stats.shotHistogram.size() <= shotsFired[winner]) {
+            stats.shotHistogram.resize(shotsFired[winner] + 1, 0);
+        }
+
+        stats.numGames++;
+        stats.wins[winner]++;
+        stats.totalShots[0] += shotsFired[0];
+        stats.totalShots[1] += shotsFired[1];
+        stats.shotHistogram[shotsFired[winner]]++;
+    }
+}
+
+// function adds the results in 'other' to 'stats'
+void mergeSimulationStats(SimulationStats& stats, const SimulationStats& other) {
+    stats.numGames += other.numGames;
+    stats.numUnplayable += other.numUnplayable;
+
+    for (int computer = 0; computer < 2; computer++) {
+        stats.wins[computer] += other.wins[computer];
+        stats.totalShots[computer] += other.totalShots[computer];
+    }
+
+    if (stats.shotHistogram.size() < other.shotHistogram.size()) {
+        stats.shotHistogram.resize(other.shotHistogram.size(), 0);
+    }
+
+    for (size_t shots = 0; shots < other.shotHistogram.size(); shots++) {
+        stats.shotHistogram[shots] += other.shotHistogram[shots];
+    }
+}
+
+// a worker's queue of task indices. the owning thread takes tasks from the
+// front, idle threads steal from the back
+struct WorkQueue {
+    mutex lock;
+    deque<int> tasks;
+};
+
+// function takes a task for 'worker', first from its own queue
+// and then by stealing from the other workers. returns false once every
+// queue is empty
+bool takeTask(vector<WorkQueue>& queues, int worker, int& task) {
+    const int numThreads = queues.size();
+
+    for (int offset = 0; offset < numThreads; offset++) {
+        int victim = (worker + offset) % numThreads;
+        WorkQueue& queue = queues[victim];
+
+        lock_guard<mutex> guard(queue.lock);
+
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        if (victim == worker) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        } else {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// function runs the tasks 0 up to 'numTasks' on a work-stealing pool of
+// 'numThreads' threads. every thread starts with a contiguous block of tasks
+// and steals from the others when it runs out
+void runParallel(int numTasks, int numThreads, const function<void(int task, int worker)>& runTask) {
+    numThreads = max(1, min(numThreads, numTasks));
+
+    vector<WorkQueue> queues(numThreads);
+
+    for (int task = 0; task < numTasks; task++) {
+        queues[(long long)task * numThreads / numTasks].tasks.push_back(task);
+    }
+
+    // runs everything on the calling thread when there is nothing to share
+    if (numThreads == 1) {
+        for (int task = 0; task < numTasks; task++) {
+            runTask(task, 0);
+        }
+
+        return;
+    }
+
+    vector<thread> threads;
+
+    for (int worker = 0; worker < numThreads; worker++) {
+        threads.emplace_back([&queues, &runTask, worker]() {
+            int task;
+
+            while (takeTask(queues, worker, task)) {
+                runTask(task, worker);
+            }
+        });
+    }
+
+    for (thread& workerThread : threads) {
+        workerThread.join();
+    }
+}
+
+// function spreads 'numGames' headless games over 'numThreads' threads. the
+// games are split into small chunks so idle threads can steal the remaining
+// work, and each thread keeps its own results which are merged at the end.
+// the results only depend on 'masterSeed'. the games are recorded into
+// 'writer' if it is not null, in the order they finish
+void runTournament(long long numGames, int numThreads, uint64_t masterSeed, const GameConfig& config, SimulationStats& stats, GameRecordWriter* writer) {
+    const long long gamesPerChunk = 256;
+
+    int numChunks = (numGames + gamesPerChunk - 1) / gamesPerChunk;
+
+    numThreads = max(1, numThreads);
+
+    // every worker plays all of its chunks in the same context
+    vector<SimulationStats> workerStats(numThreads);
+    vector<GameContext> contexts(numThreads);
+    vector<GameRecorder> recorders(numThreads);
+
+    runParallel(numChunks, numThreads, [&](int chunk, int worker) {
+        long long firstGame = chunk * gamesPerChunk;
+
+        runSimulations(firstGame, min(gamesPerChunk, numGames - firstGame), masterSeed, config, contexts[worker], recorders[worker], workerStats[worker], writer);
+    });
+
+    for (const SimulationStats& other : workerStats) {
+        mergeSimulationStats(stats, other);
+    }
+}
+
+// function prints the win rates and the distribution of shots the winner
+// needed to sink the opposing fleet
+void printSimulationStats(const SimulationStats& stats, double elapsedSeconds) {
+    const int maxShots = (int)stats.shotHistogram.size() - 1;
+
+    if (stats.numUnplayable > 0) {
+        cout << stats.numUnplayable << " games could not be played, a fleet could not be laid out on the board.\n";
+    }
+
+    if (stats.numGames == 0) {
+        cout << "No games were simulated.\n";
+        return;
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "Games simulated: " << stats.numGames << " in " << elapsedSeconds << "s";
+
+    if (elapsedSeconds > 0) {
+        cout << " (" << stats.numGames / elapsedSeconds * 60 << " games/min)";
+    }
+
+    cout << "\n";
+
+    for (int computer = 0; computer < 2; computer++) {
+        cout << "Computer " << computer + 1 << " wins: " << stats.wins[computer] << " ("
+             << 100.0 * stats.wins[computer] / stats.numGames << "%), average shots per game: "
+             << double(stats.totalShots[computer]) / stats.numGames << "\n";
+    }
+
+    // finds the smallest and largest shot counts that occurred, along with
+    // the mean and the median
+    int minShots = -1, maxShotsSeen = 0, medianShots = 0;
+    long long gamesSeen = 0, totalWinnerShots = 0;
+
+    for (int shots = 0; shots <= maxShots; shots++) {
+        long long count = stats.shotHistogram[shots];
+
+        if (count == 0) {
+            continue;
+        }
+
+        if (minShots == -1) {
+            minShots = shots;
+        }
+
+        maxShotsSeen = shots;
+        totalWinnerShots += count * shots;
+
+        if (gamesSeen < (stats.numGames + 1) / 2 && gamesSeen + count >= (stats.numGames + 1) / 2) {
+            medianShots = shots;
+        }
+
+        gamesSeen += count;
+    }
+
+    cout << "Shots needed to win: min " << minShots << ", median " << medianShots << ", mean "
+         << double(totalWinnerShots) / stats.numGames << ", max " << maxShotsSeen << "\n";
+
+    // prints the distribution
+    for (int shots = minShots; shots <= maxShotsSeen; shots++) {
+        cout << setw(4) << shots << " shots: " << setw(10) << stats.shotHistogram[shots] << " ("
+             << setw(6) << 100.0 * stats.shotHistogram[shots] / stats.numGames << "%)\n";
+    }
+}
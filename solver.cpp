@@ -0,0 +1,460 @@
+#include "header.h"
+
+// the exact endgame solver lists every layout of the ships still afloat that
+// agrees with the hits, the misses and the sunken ships, and counts how many
+// of them cover each cell. ships are placed one at a time, largest first.
+// two partial layouts that take up the same cells with the same ships can be
+// finished in the same ways, so the number of ways to finish one is only
+// worked out once and remembered
+
+// how long a solve may run, worked out when it starts
+struct SolverLimits {
+    size_t maxMemoryBytes;
+    bool hasDeadline;
+    chrono::steady_clock::time_point deadline;
+};
+
+// function returns the hash of the partial layout 'layout' with 'depth' ships
+// placed
+uint64_t hashLayout(const uint64_t* layout, int numWords, int depth) {
+    uint64_t hash = depth;
+
+    for (int word = 0; word < numWords; word++) {
+        hash = (hash ^ layout[word]) * 0xFF51AFD7ED558CCD;
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+// function returns the slot of the hash table that holds 'layout' with
+// 'depth' ships placed, or the empty slot where it would go
+int findSlot(const SolverScratch& scratch, const uint64_t* layout, int depth) {
+    const int numWords = scratch.numWords;
+    const int slotMask = scratch.memoDepths.size() - 1;
+
+    int slot = hashLayout(layout, numWords, depth) & slotMask;
+
+    while (scratch.memoDepths[slot] != -1 &&
+           (scratch.memoDepths[slot] != depth || !equal(layout, layout + numWords, &scratch.memoKeys[slot * numWords]))) {
+        slot = (slot + 1) & slotMask;
+    }
+
+    return slot;
+}
+
+// function doubles the size of the hash table, keeping what it holds.
+// returns false if the bigger table would not fit in the memory limit
+bool growMemo(SolverScratch& scratch, const SolverLimits& limits) {
+    const int numWords = scratch.numWords;
+    const size_t slotBytes = numWords * sizeof(uint64_t) + sizeof(int) + 2 * sizeof(double) + sizeof(int);
+    const int capacity = max<int>(1024, 2 * scratch.memoDepths.size());
+
+    if (capacity * slotBytes > limits.maxMemoryBytes) {
+        return false;
+    }
+
+    vector<uint64_t> oldKeys(capacity * numWords);
+    vector<int> oldDepths(capacity, -1);
+    vector<double> oldLayouts(capacity);
+    vector<double> oldWeights(capacity);
+    vector<int> oldSlots;
+
+    oldSlots.reserve(capacity / 2);
+    scratch.currentLevel.reserve(capacity / 2);
+    scratch.nextLevel.reserve(capacity / 2);
+
+    scratch.memoKeys.swap(oldKeys);
+    scratch.memoDepths.swap(oldDepths);
+    scratch.memoLayouts.swap(oldLayouts);
+    scratch.memoWeights.swap(oldWeights);
+    scratch.usedSlots.swap(oldSlots);
+
+    for (int oldSlot : oldSlots) {
+        const uint64_t* layout = &oldKeys[oldSlot * numWords];
+        int slot = findSlot(scratch, layout, oldDepths[oldSlot]);
+
+        copy(layout, layout + numWords, &scratch.memoKeys[slot * numWords]);
+        scratch.memoDepths[slot] = oldDepths[oldSlot];
+        scratch.memoLayouts[slot] = oldLayouts[oldSlot];
+        scratch.memoWeights[slot] = oldWeights[oldSlot];
+        scratch.usedSlots.push_back(slot);
+    }
+
+    return true;
+}
+
+// function remembers that 'layout' with 'depth' ships placed can be finished
+// in 'numLayouts' ways. gives up the solve if the table is full
+void storeLayout(SolverScratch& scratch, const SolverLimits& limits, const uint64_t* layout, int depth, double numLayouts) {
+    // the table is kept at most half full so the searches stay short
+    if (2 * (scratch.usedSlots.size() + 1) > scratch.memoDepths.size() && !growMemo(scratch, limits)) {
+        scratch.isAborted = true;
+        return;
+    }
+
+    int slot = findSlot(scratch, layout, depth);
+
+    copy(layout, layout + scratch.numWords, &scratch.memoKeys[slot * scratch.numWords]);
+    scratch.memoDepths[slot] = depth;
+    scratch.memoLayouts[slot] = numLayouts;
+    scratch.memoWeights[slot] = 0;
+    scratch.usedSlots.push_back(slot);
+}
+
+// function checks if 'layout' covers every hit
+bool coversHits(const SolverScratch& scratch, const uint64_t* layout) {
+    for (int word = 0; word < scratch.numWords; word++) {
+        if (scratch.hitMask[word] & ~layout[word]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// function counts the ways to place the ships from 'depth' on around the
+// partial layout at 'depth' of the layout stack so that every hit ends up
+// covered
+double countCompletions(SolverScratch& scratch, const SolverLimits& limits, int depth) {
+    // the clock is only looked at every few partial layouts
+    const int nodesPerClockCheck = 1024;
+
+    const int numWords = scratch.numWords;
+    const int numShips = scratch.shipSizeIndices.size();
+    const uint64_t* layout = &scratch.layoutStack[depth * numWords];
+    const uint64_t* reach = &scratch.reach[depth * numWords];
+
+    // a hit that none of the ships left can reach stays uncovered. once
+    // every ship is placed nothing can reach anything, so this also checks
+    // that a full layout covers every hit
+    for (int word = 0; word < numWords; word++) {
+        if (scratch.hitMask[word] & ~layout[word] & ~reach[word]) {
+            return 0;
+        }
+    }
+
+    if (depth == numShips) {
+        return 1;
+    }
+
+    if (scratch.isAborted) {
+        return 0;
+    }
+
+    if (++scratch.numNodes % nodesPerClockCheck == 0 && limits.hasDeadline && chrono::steady_clock::now() >= limits.deadline) {
+        scratch.isAborted = true;
+        return 0;
+    }
+
+    int slot = findSlot(scratch, layout, depth);
+
+    if (scratch.memoDepths[slot] != -1) {
+        return scratch.memoLayouts[slot];
+    }
+
+    const int sizeIndex = scratch.shipSizeIndices[depth];
+    const bool isLastShip = (depth + 1 == numShips);
+    uint64_t* nextLayout = &scratch.layoutStack[(depth + 1) * numWords];
+
+    double numLayouts = 0;
+
+    for (int candidate = scratch.firstCandidate[sizeIndex]; candidate < scratch.firstCandidate[sizeIndex + 1]; candidate++) {
+        const uint64_t* cells = &scratch.candidateMasks[candidate * numWords];
+        bool isOverlapping = false;
+
+        for (int word = 0; word < numWords; word++) {
+            isOverlapping |= (layout[word] & cells[word]) != 0;
+            nextLayout[word] = layout[word] | cells[word];
+        }
+
+        // the last ship only has to cover the hits that are left, which is
+        // checked here instead of a level further down
+        if (!isOverlapping) {
+            numLayouts += isLastShip ? coversHits(scratch, nextLayout) : countCompletions(scratch, limits, depth + 1);
+        }
+    }
+
+    storeLayout(scratch, limits, layout, depth, numLayouts);
+
+    return numLayouts;
+}
+
+// function counts how many layouts cover each cell into 'cellLayouts'. it
+// goes through the partial layouts depth by depth, carrying the number of
+// ways to get to each one. every placement then covers its cells in that
+// many ways times the number of ways to finish the layout after it
+void countCellLayouts(SolverScratch& scratch, const SolverLimits& limits, int numCols) {
+    const int numWords = scratch.numWords;
+    const int numShips = scratch.shipSizeIndices.size();
+
+    scratch.currentLevel.clear();
+    scratch.currentLevel.push_back(findSlot(scratch, &scratch.layoutStack[0], 0));
+    scratch.memoWeights[scratch.currentLevel[0]] = 1;
+
+    for (int depth = 0; depth < numShips && !scratch.isAborted; depth++) {
+        const int sizeIndex = scratch.shipSizeIndices[depth];
+        uint64_t* layout = &scratch.layoutStack[depth * numWords];
+        uint64_t* nextLayout = &scratch.layoutStack[(depth + 1) * numWords];
+
+        scratch.nextLevel.clear();
+
+        for (int slot : scratch.currentLevel) {
+            const double weight = scratch.memoWeights[slot];
+
+            copy(&scratch.memoKeys[slot * numWords], &scratch.memoKeys[(slot + 1) * numWords], layout);
+
+            for (int candidate = scratch.firstCandidate[sizeIndex]; candidate < scratch.firstCandidate[sizeIndex + 1]; candidate++) {
+                const uint64_t* cells = &scratch.candidateMasks[candidate * numWords];
+                bool isOverlapping = false;
+
+                for (int word = 0; word < numWords; word++) {
+                    isOverlapping |= (layout[word] & cells[word]) != 0;
+                    nextLayout[word] = layout[word] | cells[word];
+                }
+
+                // every layout that can still be finished was counted
+                // already, so this only looks its count up
+                double numCompletions = 0;
+
+                if (!isOverlapping) {
+                    numCompletions = (depth + 1 == numShips) ? coversHits(scratch, nextLayout) : countCompletions(scratch, limits, depth + 1);
+                }
+
+                if (numCompletions == 0) {
+                    continue;
+                }
+
+                const Placement& placement = scratch.candidates[candidate];
+                const int step = (placement.orientation == 'V') ? numCols : 1;
+
+                int cell = placement.rowIndex * numCols + placement.colIndex;
+
+                for (int offset = 0; offset < placement.shipSize; offset++, cell += step) {
+                    scratch.cellLayouts[cell] += weight * numCompletions;
+                }
+
+                if (depth + 1 < numShips) {
+                    int nextSlot = findSlot(scratch, nextLayout, depth + 1);
+
+                    if (scratch.memoWeights[nextSlot] == 0) {
+                        scratch.nextLevel.push_back(nextSlot);
+                    }
+
+                    scratch.memoWeights[nextSlot] += weight;
+                }
+            }
+        }
+
+        scratch.currentLevel.swap(scratch.nextLevel);
+    }
+}
+
+// function picks the computer's shot by counting every layout of the ships
+// still afloat once there are few enough of them, and shooting at the cell
+// that the most layouts cover. ties are broken at random. returns false if
+// the solver is off, there are too many layouts or the solve ran past its
+// limits, in which case the targeting engine picks the shot
+bool solveEndgameShot(const Player& opponent, int fleetSize, ComputerState& computer, Point& targetShot, GameRng& rng) {
+    const ExactSolverSettings& settings = computer.exactSolver;
+    const PlacementIndex& index = computer.placementIndex;
+    const PlacementTable& table = *index.table;
+    const int numSizes = table.shipSizes.size();
+    const int numRows = opponent.board.numRows;
+    const int numCols = opponent.board.numCols;
+    const int numCells = numRows * numCols;
+
+    if (settings.layoutThreshold <= 0 || fleetSize == 0) {
+        return false;
+    }
+
+    // with a single ship left and no hits the placement index already
+    // counts every layout exactly
+    if (fleetSize == 1 && computer.hits.empty()) {
+        return false;
+    }
+
+    // a ship can take one of the placements that avoid every shot, or one
+    // through a hit. counting those as if every ship could take any of
+    // them gives a quick upper bound on the layouts
+    double maxLayouts = 1;
+
+    for (int sizeIndex = 0; sizeIndex < numSizes; sizeIndex++) {
+        const int shipSize = table.shipSizes[sizeIndex];
+        const int numPlacements = table.firstPlacement[sizeIndex + 1] - table.firstPlacement[sizeIndex];
+        const double numChoices = min<double>(numPlacements, index.numLivePlacements[sizeIndex] + 2.0 * shipSize * computer.hits.size());
+
+        for (int shipIndex = 0; shipIndex < index.numShips[sizeIndex]; shipIndex++) {
+            maxLayouts *= numChoices;
+        }
+    }
+
+    if (maxLayouts > settings.layoutThreshold) {
+        return false;
+    }
+
+    SolverScratch& scratch = computer.solver;
+    const int numWords = (numCells + 63) / 64;
+
+    // the hash table is only kept for layouts of the same size
+    if (scratch.numWords != numWords) {
+        scratch.numWords = numWords;
+        scratch.memoKeys.clear();
+        scratch.memoDepths.clear();
+        scratch.memoLayouts.clear();
+        scratch.memoWeights.clear();
+        scratch.usedSlots.clear();
+    }
+
+    for (int slot : scratch.usedSlots) {
+        scratch.memoDepths[slot] = -1;
+    }
+
+    scratch.usedSlots.clear();
+    scratch.numNodes = 0;
+    scratch.isAborted = false;
+
+    // the ships left, largest first, and every placement each size can
+    // have: in bounds, clear of the misses and the sunken ships, and not
+    // only on hits since the ship would have sunk
+    scratch.shipSizeIndices.clear();
+    scratch.candidates.clear();
+    scratch.candidateMasks.clear();
+    scratch.firstCandidate.assign(numSizes + 1, 0);
+
+    // every buffer is sized for the whole fleet, so a later solve with more
+    // ships left does not have to grow them
+    const int maxShips = opponent.fleet.size();
+
+    scratch.shipSizeIndices.reserve(maxShips);
+    scratch.hitMask.reserve(numWords);
+    scratch.reach.reserve((maxShips + 1) * numWords);
+    scratch.layoutStack.reserve((maxShips + 1) * numWords);
+    scratch.cellLayouts.reserve(numCells);
+    scratch.candidates.reserve(table.firstPlacement.back());
+    scratch.candidateMasks.reserve(table.firstPlacement.back() * numWords);
+
+    for (int sizeIndex = 0; sizeIndex < numSizes; sizeIndex++) {
+        scratch.firstCandidate[sizeIndex] = scratch.candidates.size();
+
+        if (index.numShips[sizeIndex] == 0) {
+            continue;
+        }
+
+        scratch.shipSizeIndices.insert(scratch.shipSizeIndices.end(), index.numShips[sizeIndex], sizeIndex);
+
+        for (int placementNumber = table.firstPlacement[sizeIndex]; placementNumber < table.firstPlacement[sizeIndex + 1]; placementNumber++) {
+            const Placement placement = getPlacement(table, sizeIndex, placementNumber);
+            const int step = (placement.orientation == 'V') ? numCols : 1;
+
+            int cell = placement.rowIndex * numCols + placement.colIndex;
+            int numHits = 0;
+            bool isPossible = true;
+
+            for (int offset = 0; offset < placement.shipSize && isPossible; offset++, cell += step) {
+                char loc = opponent.board.cells[cell];
+
+                isPossible = loc != 'O' && !computer.sunkCells.cells[cell];
+                numHits += (loc == 'X');
+            }
+
+            if (!isPossible || numHits == placement.shipSize) {
+                continue;
+            }
+
+            scratch.candidates.push_back(placement);
+            scratch.candidateMasks.resize(scratch.candidateMasks.size() + numWords, 0);
+
+            uint64_t* cells = &scratch.candidateMasks[scratch.candidateMasks.size() - numWords];
+
+            cell = placement.rowIndex * numCols + placement.colIndex;
+
+            for (int offset = 0; offset < placement.shipSize; offset++, cell += step) {
+                cells[cell / 64] |= uint64_t(1) << (cell % 64);
+            }
+        }
+    }
+
+    scratch.firstCandidate[numSizes] = scratch.candidates.size();
+
+    sort(scratch.shipSizeIndices.begin(), scratch.shipSizeIndices.end(), [&](int a, int b) {
+        return table.shipSizes[a] > table.shipSizes[b];
+    });
+
+    const int numShips = scratch.shipSizeIndices.size();
+
+    scratch.hitMask.assign(numWords, 0);
+    scratch.reach.assign((numShips + 1) * numWords, 0);
+    scratch.layoutStack.assign((numShips + 1) * numWords, 0);
+
+    for (const Point& hit : computer.hits) {
+        int cell = hit.rowIndex * numCols + hit.colIndex;
+
+        scratch.hitMask[cell / 64] |= uint64_t(1) << (cell % 64);
+    }
+
+    for (int depth = numShips - 1; depth >= 0; depth--) {
+        const int sizeIndex = scratch.shipSizeIndices[depth];
+
+        for (int word = 0; word < numWords; word++) {
+            scratch.reach[depth * numWords + word] = scratch.reach[(depth + 1) * numWords + word];
+        }
+
+        for (int candidate = scratch.firstCandidate[sizeIndex]; candidate < scratch.firstCandidate[sizeIndex + 1]; candidate++) {
+            for (int word = 0; word < numWords; word++) {
+                scratch.reach[depth * numWords + word] |= scratch.candidateMasks[candidate * numWords + word];
+            }
+        }
+    }
+
+    const SolverLimits limits = {settings.maxMemoryBytes, settings.timeBudgetMs > 0,
+                                 chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(settings.timeBudgetMs))};
+
+    // the table is kept at most half full, so it is made twice the
+    // threshold up front, which holds as many partial layouts as the
+    // threshold without growing. a solve that remembers more still grows it
+    // in 'storeLayout()', up to the memory limit
+    while (scratch.memoDepths.size() < 2 * settings.layoutThreshold && growMemo(scratch, limits)) {
+    }
+
+    if (scratch.memoDepths.empty()) {
+        return false;
+    }
+
+    // a solve that went through puts the empty layout in the table too, so
+    // the count of the cells can start from it
+    double numLayouts = countCompletions(scratch, limits, 0);
+
+    if (scratch.isAborted || numLayouts == 0) {
+        return false;
+    }
+
+    scratch.cellLayouts.assign(numCells, 0);
+    countCellLayouts(scratch, limits, numCols);
+
+    if (scratch.isAborted) {
+        return false;
+    }
+
+    // picks the cell that has not been shot with the most layouts on it
+    double mostLayouts = 0;
+    int numTies = 0;
+
+    for (int cell = 0; cell < numCells; cell++) {
+        char loc = opponent.board.cells[cell];
+
+        if (loc == 'X' || loc == 'O' || scratch.cellLayouts[cell] == 0) {
+            continue;
+        }
+
+        if (scratch.cellLayouts[cell] > mostLayouts) {
+            mostLayouts = scratch.cellLayouts[cell];
+            numTies = 1;
+            targetShot = {cell / numCols, cell % numCols};
+        } else if (scratch.cellLayouts[cell] == mostLayouts && randomBelow(rng, ++numTies) == 0) {
+            targetShot = {cell / numCols, cell % numCols};
+        }
+    }
+
+    return numTies > 0;
+}
@@ -0,0 +1,147 @@
+// checks that records with a shot off the board are taken for corrupt, both
+// when a record file is summarized and when it is replayed. a real game is
+// recorded, then its first shot is swapped for one at a crafted cell. build
+// from the repository root with
+//
+//   g++ -std=c++17 -O2 -I. tests/record_test.cpp adversary.cpp bitboard.cpp functions.cpp input.cpp instrument.cpp matchmaking.cpp montecarlo.cpp placement.cpp record.cpp render.cpp replay.cpp server.cpp session.cpp simulation.cpp solver.cpp -lpthread -o record_test
+//
+// and run it from there so 'ships.txt' is found. the program fails if a
+// corrupt record is accepted or the untouched one is not
+#include "header.h"
+
+// function appends 'value' to 'bytes' as a varint, the way records store it
+void appendVarint(vector<uint8_t>& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+
+    bytes.push_back(uint8_t(value));
+}
+
+// function reads the whole file 'path' into 'bytes'
+bool readFileBytes(const string& path, vector<uint8_t>& bytes) {
+    ifstream in(path, ios::binary);
+
+    if (!in) {
+        return false;
+    }
+
+    bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+
+    return true;
+}
+
+void writeFileBytes(const string& path, const vector<uint8_t>& bytes) {
+    ofstream out(path, ios::binary | ios::trunc);
+
+    out.write((const char*)bytes.data(), bytes.size());
+}
+
+// function returns the file 'bytes' with the first shot of its first game
+// replaced by a miss at 'cell', which is stored without any check
+vector<uint8_t> replaceFirstShot(const vector<uint8_t>& bytes, uint64_t cell) {
+    GameRecordFile file;
+
+    file.data = bytes.data();
+    file.size = bytes.size();
+
+    RecordReader reader = makeRecordReader(file);
+    RecordedGame game;
+    RecordedPlacement placement;
+    RecordedShot shot;
+
+    readGameHeader(reader, game);
+
+    for (int placementIndex = 0; placementIndex < 2 * game.numShips; placementIndex++) {
+        readPlacement(reader, game, placementIndex, placement);
+    }
+
+    const size_t shotStart = reader.next - file.data;
+
+    readShot(reader, game, shot);
+
+    vector<uint8_t> corrupt(bytes.begin(), bytes.begin() + shotStart);
+
+    appendVarint(corrupt, 1 + cell * 8 + SHOT_MISS * 2 + shot.shooter);
+    corrupt.insert(corrupt.end(), bytes.begin() + (reader.next - file.data), bytes.end());
+
+    return corrupt;
+}
+
+// function checks if both the summary and the replay of 'path' accept it
+bool isRecordAccepted(const string& path, const GameConfig& config, bool& isSummaryAccepted, bool& isReplayAccepted) {
+    isSummaryAccepted = summarizeGameRecords(path);
+    isReplayAccepted = replayGameRecords(path, config, 1);
+
+    return isSummaryAccepted && isReplayAccepted;
+}
+
+int main() {
+    const string path = "record_test.bsgr";
+
+    GameConfig config;
+
+    auto fleetTemplate = make_shared<FleetTemplate>();
+    string fleetError;
+
+    if (!loadFleetTemplate(*fleetTemplate, config.shipsFile, fleetError)) {
+        cout << fleetError << "\n";
+        return 1;
+    }
+
+    config.fleetTemplate = fleetTemplate;
+
+    GameRecordWriter writer;
+    SimulationStats stats;
+
+    if (!openGameRecordWriter(writer, path)) {
+        cout << "Can not write " << path << "\n";
+        return 1;
+    }
+
+    runTournament(1, 1, 42, config, stats, &writer);
+    closeGameRecordWriter(writer);
+
+    vector<uint8_t> bytes;
+
+    if (!readFileBytes(path, bytes)) {
+        cout << "Can not read " << path << "\n";
+        return 1;
+    }
+
+    bool isSummaryAccepted, isReplayAccepted;
+    int numFailures = 0;
+
+    if (!isRecordAccepted(path, config, isSummaryAccepted, isReplayAccepted)) {
+        cout << "FAIL: the untouched record was not accepted\n";
+        numFailures++;
+    }
+
+    const uint64_t numCells = config.numRows * config.numCols;
+
+    // the cell right past the board, one that turns into -1 as an 'int', and
+    // the largest cell a 64-bit shot can hold
+    const uint64_t corruptCells[] = {numCells, 0xFFFFFFFFull, (~0ull - 1) / 8};
+
+    for (uint64_t cell : corruptCells) {
+        writeFileBytes(path, replaceFirstShot(bytes, cell));
+
+        isRecordAccepted(path, config, isSummaryAccepted, isReplayAccepted);
+
+        if (isSummaryAccepted || isReplayAccepted) {
+            cout << "FAIL: a shot at cell " << cell << " was accepted by the" << (isSummaryAccepted ? " summary" : "") << (isReplayAccepted ? " replay" : "") << "\n";
+            numFailures++;
+        }
+    }
+
+    remove(path.c_str());
+
+    if (numFailures != 0) {
+        cout << numFailures << " record checks failed.\n";
+        return 1;
+    }
+
+    cout << "Every record check passed.\n";
+    return 0;
+}